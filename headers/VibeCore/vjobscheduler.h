@@ -0,0 +1 @@
+#include "../../src/core/jobs/vjobscheduler.h"
@@ -43,6 +43,7 @@
 #include <VibeCore/VStringHandler>
 
 #include "vbookmark.h"
+#include "vbookmarkindex_p.h"
 
 #define METADATA_MAUI_OWNER "http://www.maui-os.org"
 #define METADATA_FREEDESKTOP_OWNER "http://freedesktop.org"
@@ -79,6 +80,11 @@ static QDomText get_or_create_text(QDomNode node)
     return subnode.toText();
 }
 
+static VBookmarkIndex *indexFor(const QDomNode &node)
+{
+    return VBookmarkIndex::forDocument(node.ownerDocument());
+}
+
 static QDomNode findMetadata(const QString &forOwner, QDomNode &parent, bool create)
 {
     bool forOwnerIsUs = forOwner == METADATA_MAUI_OWNER;
@@ -173,6 +179,9 @@ void VBookmark::setFullText(const QString &fullText)
 
     QDomText domtext = titleNode.firstChild().toText();
     domtext.setData(fullText);
+
+    if (VBookmarkIndex *index = indexFor(element))
+        index->textChanged(element);
 }
 
 QUrl VBookmark::url() const
@@ -184,6 +193,9 @@ QUrl VBookmark::url() const
 void VBookmark::setUrl(const QUrl &url)
 {
     element.setAttribute("href", url.toString());
+
+    if (VBookmarkIndex *index = indexFor(element))
+        index->urlChanged(element);
 }
 
 QString VBookmark::icon() const
@@ -248,6 +260,9 @@ void VBookmark::setDescription(const QString &description)
 
     QDomText domtext = descNode.firstChild().toText();
     domtext.setData(description);
+
+    if (VBookmarkIndex *index = indexFor(element))
+        index->textChanged(element);
 }
 
 QMimeType VBookmark::mimeType() const
@@ -295,6 +310,12 @@ VBookmarkGroup VBookmark::toGroup() const
 
 QString VBookmark::address() const
 {
+    if (VBookmarkIndex *index = indexFor(element)) {
+        const QString address = index->address(element);
+        if (!address.isNull())
+            return address;
+    }
+
     if (element.tagName() == "xbel")
         return ""; // not QString() !
     else {
@@ -314,6 +335,8 @@ QString VBookmark::address() const
 
 int VBookmark::positionInParent() const
 {
+    if (VBookmarkIndex *index = indexFor(element))
+        return index->positionInParent(element);
     return parentGroup().indexOf(*this);
 }
 
@@ -547,6 +570,12 @@ VBookmark VBookmarkGroup::next(const VBookmark &current) const
 
 int VBookmarkGroup::indexOf(const VBookmark &child) const
 {
+    if (VBookmarkIndex *index = indexFor(element)) {
+        if (child.element.parentNode() == element)
+            return index->positionInParent(child.element);
+        return -1;
+    }
+
     uint counter = 0;
     for (VBookmark bk = first(); !bk.isNull(); bk = next(bk), ++counter) {
         if (bk.element == child.element)
@@ -584,6 +613,10 @@ VBookmarkGroup VBookmarkGroup::createNewFolder(const QString &text)
     QDomElement textElem = doc.createElement("title");
     groupElem.appendChild(textElem);
     textElem.appendChild(doc.createTextNode(text));
+
+    if (VBookmarkIndex *index = indexFor(element))
+        index->inserted(groupElem);
+
     return VBookmarkGroup(groupElem);
 }
 
@@ -596,6 +629,10 @@ VBookmark VBookmarkGroup::createNewSeparator()
     Q_ASSERT(!doc.isNull());
     QDomElement sepElem = doc.createElement("separator");
     element.appendChild(sepElem);
+
+    if (VBookmarkIndex *index = indexFor(element))
+        index->inserted(sepElem);
+
     return VBookmark(sepElem);
 }
 
@@ -619,12 +656,22 @@ bool VBookmarkGroup::moveBookmark(const VBookmark &item, const VBookmark &after)
         }
     }
 
-    return (!n.isNull());
+    if (n.isNull())
+        return false;
+
+    if (VBookmarkIndex *index = indexFor(element))
+        index->inserted(item.element);
+
+    return true;
 }
 
 VBookmark VBookmarkGroup::addBookmark(const VBookmark &bm)
 {
     element.appendChild(bm.internalElement());
+
+    if (VBookmarkIndex *index = indexFor(element))
+        index->inserted(bm.internalElement());
+
     return bm;
 }
 
@@ -652,6 +699,9 @@ VBookmark VBookmarkGroup::addBookmark(const QString &text, const QUrl &url, cons
 void VBookmarkGroup::deleteBookmark(const VBookmark &bk)
 {
     element.removeChild(bk.element);
+
+    if (VBookmarkIndex *index = indexFor(element))
+        index->removed(bk.element);
 }
 
 bool VBookmarkGroup::isToolbarGroup() const
@@ -0,0 +1,483 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#include <QtCore/QMutex>
+#include <QtCore/QVarLengthArray>
+
+#include "vbookmarkindex_p.h"
+#include "vbookmarksearchindex_p.h"
+
+/*
+ * Utility functions.
+ */
+
+namespace
+{
+    // There are only a few documents, one for each bookmark manager
+    struct IndexRegistry {
+        QMutex mutex;
+        QList<VBookmarkIndex *> indexes;
+    };
+}
+
+Q_GLOBAL_STATIC(IndexRegistry, s_registry)
+
+/*
+ * VBookmarkIndex
+ */
+
+VBookmarkIndex::VBookmarkIndex()
+    : m_built(false)
+    , m_nextId(1)
+    , m_root(0)
+    , m_search(0)
+{
+}
+
+VBookmarkIndex::~VBookmarkIndex()
+{
+    setDocument(QDomDocument());
+}
+
+VBookmarkIndex *VBookmarkIndex::forDocument(const QDomDocument &document)
+{
+    if (document.isNull())
+        return 0;
+
+    IndexRegistry *registry = s_registry();
+    if (!registry)
+        return 0;
+
+    // QDomNode::operator==() tells whether both refer to the same document
+    QMutexLocker locker(&registry->mutex);
+    foreach (VBookmarkIndex *index, registry->indexes) {
+        if (index->m_document == document)
+            return index;
+    }
+    return 0;
+}
+
+bool VBookmarkIndex::isIndexedTag(const QString &tagName)
+{
+    return tagName == QLatin1String("bookmark") ||
+           tagName == QLatin1String("folder") ||
+           tagName == QLatin1String("separator");
+}
+
+void VBookmarkIndex::setDocument(const QDomDocument &document)
+{
+    IndexRegistry *registry = s_registry();
+    if (registry) {
+        // forDocument() compares m_document with the registry locked
+        QMutexLocker locker(&registry->mutex);
+
+        registry->indexes.removeAll(this);
+        if (!document.isNull())
+            registry->indexes.append(this);
+        m_document = document;
+    } else {
+        m_document = document;
+    }
+
+    invalidate();
+}
+
+QDomDocument VBookmarkIndex::document() const
+{
+    return m_document;
+}
+
+void VBookmarkIndex::invalidate()
+{
+    delete m_search;
+    m_search = 0;
+
+    // Cleared first, so that destroying the nodes doesn't look them up
+    m_byId.clear();
+    m_byUrl.clear();
+    m_others.clear();
+
+    if (m_root)
+        destroyNode(m_root);
+
+    m_root = 0;
+    m_built = false;
+}
+
+quint32 VBookmarkIndex::id(const QDomElement &element)
+{
+    Node *node = lookup(element);
+    return node ? node->id : 0;
+}
+
+QDomElement VBookmarkIndex::element(quint32 id)
+{
+    if (!m_built)
+        build();
+
+    Node *node = m_byId.value(id);
+    return node ? node->element : QDomElement();
+}
+
+QString VBookmarkIndex::address(const QDomElement &element)
+{
+    Node *node = lookup(element);
+    if (!node)
+        return QString();
+
+    QVarLengthArray<int, 16> positions;
+    while (node && node != m_root) {
+        positions.append(node->position);
+        node = node->parent;
+    }
+
+    // Not part of the tree anymore
+    if (!node)
+        return QString();
+
+    // The root address is an empty string, not a null one
+    QString address(QLatin1String(""));
+    for (int i = positions.size() - 1; i >= 0; --i) {
+        address += QLatin1Char('/');
+        address += QString::number(positions[i]);
+    }
+    return address;
+}
+
+int VBookmarkIndex::positionInParent(const QDomElement &element)
+{
+    Node *node = lookup(element);
+    return node ? node->position : -1;
+}
+
+QDomElement VBookmarkIndex::findByAddress(const QString &address)
+{
+    if (!m_built)
+        build();
+
+    Node *node = m_root;
+    if (!node)
+        return QDomElement();
+
+    // The address is something like /5/10/2+
+    int number = -1;
+    const QChar *c = address.constData();
+    const QChar *end = c + address.size();
+    for (;; ++c) {
+        if (c == end || *c == QLatin1Char('/') || *c == QLatin1Char('+')) {
+            if (number >= 0) {
+                if (number >= node->children.size())
+                    return QDomElement();
+                node = node->children.at(number);
+                number = -1;
+            }
+            if (c == end)
+                break;
+        } else if (c->isDigit()) {
+            number = (number < 0 ? 0 : number * 10) + c->digitValue();
+        } else {
+            return QDomElement();
+        }
+    }
+
+    return node->element;
+}
+
+QList<QDomElement> VBookmarkIndex::findByUrl(const QString &url)
+{
+    if (!m_built)
+        build();
+
+    QList<QDomElement> elements;
+    const QVector<Node *> nodes = m_byUrl.value(url);
+    elements.reserve(nodes.size());
+    for (int i = 0; i < nodes.size(); ++i)
+        elements.append(nodes.at(i)->element);
+    return elements;
+}
+
+QList<QDomElement> VBookmarkIndex::search(const QString &text, int maximum)
+{
+    if (!m_built)
+        build();
+
+    if (!m_search) {
+        m_search = new VBookmarkSearchIndex();
+        for (QHash<quint32, Node *>::const_iterator it = m_byId.constBegin();
+                it != m_byId.constEnd(); ++it)
+            addText(it.value());
+    }
+
+    QList<QDomElement> elements;
+    const QVector<quint32> ids = m_search->search(text, maximum);
+    elements.reserve(ids.size());
+    for (int i = 0; i < ids.size(); ++i)
+        elements.append(m_byId.value(ids.at(i))->element);
+    return elements;
+}
+
+void VBookmarkIndex::inserted(const QDomElement &element)
+{
+    if (!m_built || !isIndexedTag(element.tagName()))
+        return;
+
+    Node *node = find(element);
+    Node *parent = find(element.parentNode());
+
+    if (node && node->parent)
+        detach(node);
+
+    // Moved out of the indexed tree
+    if (!parent) {
+        if (node)
+            destroyNode(node);
+        return;
+    }
+
+    // Right after the closest indexed sibling, which for the common
+    // append case is the previous element
+    int position = 0;
+    for (QDomElement prev = element.previousSiblingElement(); !prev.isNull();
+            prev = prev.previousSiblingElement()) {
+        if (isIndexedTag(prev.tagName())) {
+            Node *prevNode = find(prev);
+            if (!prevNode || prevNode->parent != parent) {
+                // The DOM was changed behind our back
+                invalidate();
+                return;
+            }
+            position = prevNode->position + 1;
+            break;
+        }
+    }
+
+    if (node) {
+        node->parent = parent;
+        node->position = position;
+    } else {
+        node = createNode(element, parent, position);
+        indexChildren(node);
+    }
+
+    parent->children.insert(position, node);
+    renumber(parent, position);
+}
+
+void VBookmarkIndex::removed(const QDomElement &element)
+{
+    if (!m_built)
+        return;
+
+    Node *node = find(element);
+    if (!node || node == m_root)
+        return;
+
+    if (node->parent)
+        detach(node);
+    destroyNode(node);
+}
+
+void VBookmarkIndex::urlChanged(const QDomElement &element)
+{
+    if (!m_built)
+        return;
+
+    // Still filed under the previous URL
+    Node *node = 0;
+    for (QHash<quint32, Node *>::const_iterator it = m_byId.constBegin();
+            it != m_byId.constEnd() && !node; ++it) {
+        if (it.value()->element == element)
+            node = it.value();
+    }
+    if (!node || node->element.tagName() != QLatin1String("bookmark"))
+        return;
+
+    removeUrl(node);
+    addUrl(node);
+    addText(node);
+}
+
+void VBookmarkIndex::textChanged(const QDomElement &element)
+{
+    if (!m_built || !m_search)
+        return;
+
+    Node *node = find(element);
+    if (node)
+        addText(node);
+}
+
+void VBookmarkIndex::build()
+{
+    m_built = true;
+
+    QDomElement rootElement = m_document.documentElement();
+    if (rootElement.isNull())
+        return;
+
+    m_root = createNode(rootElement, 0, -1);
+    indexChildren(m_root);
+}
+
+VBookmarkIndex::Node *VBookmarkIndex::createNode(const QDomElement &element, Node *parent, int position)
+{
+    Node *node = new Node;
+    node->id = m_nextId++;
+    node->element = element;
+    node->parent = parent;
+    node->position = position;
+
+    m_byId.insert(node->id, node);
+    if (element.tagName() != QLatin1String("bookmark"))
+        m_others.append(node);
+    addUrl(node);
+    addText(node);
+
+    return node;
+}
+
+void VBookmarkIndex::indexChildren(Node *node)
+{
+    if (node->element.tagName() == QLatin1String("separator") ||
+            node->element.tagName() == QLatin1String("bookmark"))
+        return;
+
+    for (QDomElement child = node->element.firstChildElement(); !child.isNull();
+            child = child.nextSiblingElement()) {
+        if (!isIndexedTag(child.tagName()))
+            continue;
+
+        Node *childNode = createNode(child, node, node->children.size());
+        node->children.append(childNode);
+        indexChildren(childNode);
+    }
+}
+
+void VBookmarkIndex::destroyNode(Node *node)
+{
+    for (int i = 0; i < node->children.size(); ++i)
+        destroyNode(node->children.at(i));
+
+    removeUrl(node);
+    if (m_search)
+        m_search->remove(node->id);
+    if (node->element.tagName() != QLatin1String("bookmark")) {
+        const int i = m_others.indexOf(node);
+        if (i >= 0) {
+            m_others[i] = m_others.last();
+            m_others.removeLast();
+        }
+    }
+    m_byId.remove(node->id);
+    delete node;
+}
+
+void VBookmarkIndex::detach(Node *node)
+{
+    Node *parent = node->parent;
+    parent->children.remove(node->position);
+    renumber(parent, node->position);
+    node->parent = 0;
+    node->position = -1;
+}
+
+void VBookmarkIndex::renumber(Node *parent, int from)
+{
+    for (int i = from; i < parent->children.size(); ++i)
+        parent->children.at(i)->position = i;
+}
+
+VBookmarkIndex::Node *VBookmarkIndex::lookup(const QDomElement &element)
+{
+    if (!m_built)
+        build();
+
+    return find(element);
+}
+
+VBookmarkIndex::Node *VBookmarkIndex::find(const QDomNode &domNode) const
+{
+    const QDomElement element = domNode.toElement();
+    if (element.isNull())
+        return 0;
+
+    if (element.tagName() != QLatin1String("bookmark"))
+        return find(m_others, element);
+
+    QHash<QString, QVector<Node *> >::const_iterator it =
+        m_byUrl.constFind(element.attribute(QLatin1String("href")));
+    return it != m_byUrl.constEnd() ? find(it.value(), element) : 0;
+}
+
+VBookmarkIndex::Node *VBookmarkIndex::find(const QVector<Node *> &nodes, const QDomElement &element)
+{
+    for (int i = 0; i < nodes.size(); ++i) {
+        if (nodes.at(i)->element == element)
+            return nodes.at(i);
+    }
+    return 0;
+}
+
+void VBookmarkIndex::addUrl(Node *node)
+{
+    if (node->element.tagName() != QLatin1String("bookmark"))
+        return;
+
+    // Remember the key, the attribute might change before we're told
+    node->url = node->element.attribute(QLatin1String("href"));
+    m_byUrl[node->url].append(node);
+}
+
+void VBookmarkIndex::removeUrl(Node *node)
+{
+    QHash<QString, QVector<Node *> >::iterator it = m_byUrl.find(node->url);
+    if (it == m_byUrl.end())
+        return;
+
+    QVector<Node *> &nodes = it.value();
+    const int i = nodes.indexOf(node);
+    if (i < 0)
+        return;
+
+    // Order doesn't matter, swap with the last one
+    nodes[i] = nodes.last();
+    nodes.removeLast();
+    if (nodes.isEmpty())
+        m_byUrl.erase(it);
+}
+
+void VBookmarkIndex::addText(Node *node)
+{
+    if (!m_search || node->element.tagName() != QLatin1String("bookmark"))
+        return;
+
+    // Replaces what was there before
+    m_search->insert(node->id,
+                     node->element.namedItem(QLatin1String("title")).toElement().text(),
+                     node->element.attribute(QLatin1String("href")),
+                     node->element.namedItem(QLatin1String("desc")).toElement().text());
+}
@@ -0,0 +1,138 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#ifndef VBOOKMARKINDEX_P_H
+#define VBOOKMARKINDEX_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Vibe API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QVector>
+#include <QtXml/QDomDocument>
+#include <QtXml/QDomElement>
+
+class VBookmarkSearchIndex;
+
+/*
+ * In-memory index of the bookmark tree of a document.
+ *
+ * Every folder, bookmark and separator gets a stable id and knows its
+ * parent and its position among the parent's children, so addresses
+ * are resolved in O(depth) rather than walking the siblings at every
+ * level.  The index is built lazily on first use and then kept up to
+ * date by VBookmarkGroup, which reports every structural change.
+ *
+ * Indexes register themselves so that VBookmark and VBookmarkGroup,
+ * which only know the DOM element they wrap, can find the index of the
+ * document the element belongs to.
+ */
+class VBookmarkIndex
+{
+public:
+    VBookmarkIndex();
+    ~VBookmarkIndex();
+
+    static VBookmarkIndex *forDocument(const QDomDocument &document);
+
+    static bool isIndexedTag(const QString &tagName);
+
+    // Indexes the given document, the index is built on first use
+    void setDocument(const QDomDocument &document);
+    QDomDocument document() const;
+
+    // Drops everything, the index is rebuilt on next use
+    void invalidate();
+
+    quint32 id(const QDomElement &element);
+    QDomElement element(quint32 id);
+    QString address(const QDomElement &element);
+    int positionInParent(const QDomElement &element);
+    QDomElement findByAddress(const QString &address);
+
+    // Bookmarks pointing to the given href, in no particular order
+    QList<QDomElement> findByUrl(const QString &url);
+
+    // Bookmarks whose title, URL or description match all the words
+    // of text, the search index is built on first use
+    QList<QDomElement> search(const QString &text, int maximum = -1);
+
+    // Structural changes, to be called after the DOM has been modified
+    void inserted(const QDomElement &element);
+    void removed(const QDomElement &element);
+
+    // To be called after the href attribute of a bookmark was changed
+    void urlChanged(const QDomElement &element);
+
+    // To be called after the title or description of a bookmark was changed
+    void textChanged(const QDomElement &element);
+
+private:
+    struct Node {
+        quint32 id;
+        QDomElement element;
+        Node *parent;
+        int position;
+        QVector<Node *> children;
+        QString url;
+    };
+
+    void build();
+    Node *createNode(const QDomElement &element, Node *parent, int position);
+    void indexChildren(Node *node);
+    void destroyNode(Node *node);
+    void detach(Node *node);
+    void renumber(Node *parent, int from);
+    Node *lookup(const QDomElement &element);
+    Node *find(const QDomNode &domNode) const;
+    static Node *find(const QVector<Node *> &nodes, const QDomElement &element);
+    void addUrl(Node *node);
+    void removeUrl(Node *node);
+    void addText(Node *node);
+
+    QDomDocument m_document;
+    bool m_built;
+    quint32 m_nextId;
+    Node *m_root;
+    QHash<quint32, Node *> m_byId;
+    // Bookmarks are found through their URL, everything else is in
+    // m_others; QDomNode can't be hashed, candidates are compared
+    QHash<QString, QVector<Node *> > m_byUrl;
+    QVector<Node *> m_others;
+    VBookmarkSearchIndex *m_search;
+};
+
+#endif // VBOOKMARKINDEX_P_H
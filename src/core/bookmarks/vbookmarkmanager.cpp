@@ -35,9 +35,9 @@
 #include <QtCore/QFileInfo>
 #include <QtCore/QDir>
 #include <QtCore/QProcess>
-#include <QtCore/QRegExp>
 #include <QtCore/QTextStream>
 #include <QtCore/QFileSystemWatcher>
+#include <QtCore/QTimer>
 #include <QtDBus/QtDBus>
 #include <QtWidgets/QApplication>
 #include <QStandardPaths>
@@ -46,6 +46,8 @@
 
 #include "vbookmarkmanager.h"
 #include "vbookmarkmanageradaptor.h"
+#include "vbookmarkindex_p.h"
+#include "vbookmarkxbel_p.h"
 
 const QString kToolBarCacheExtension = QLatin1String(".toolbarcache");
 
@@ -65,55 +67,6 @@ public:
 
 Q_GLOBAL_STATIC(VBookmarkManagerList, s_pSelf)
 
-/*
- * VBookmarkMap
- */
-
-class VBookmarkMap : private VBookmarkGroupTraverser
-{
-public:
-    VBookmarkMap() : m_mapNeedsUpdate(true) {}
-    void setNeedsUpdate() {
-        m_mapNeedsUpdate = true;
-    }
-    void update(VBookmarkManager *);
-    QList<VBookmark> find(const QString &url) const {
-        return m_bk_map.value(url);
-    }
-
-private:
-    virtual void visit(const VBookmark &);
-    virtual void visitEnter(const VBookmarkGroup &) {
-        ;
-    }
-    virtual void visitLeave(const VBookmarkGroup &) {
-        ;
-    }
-
-    typedef QList<VBookmark> VBookmarkList;
-    QMap<QString, VBookmarkList> m_bk_map;
-    bool m_mapNeedsUpdate;
-};
-
-void VBookmarkMap::update(VBookmarkManager *manager)
-{
-    if (m_mapNeedsUpdate) {
-        m_mapNeedsUpdate = false;
-
-        m_bk_map.clear();
-        VBookmarkGroup root = manager->root();
-        traverse(root);
-    }
-}
-
-void VBookmarkMap::visit(const VBookmark &bk)
-{
-    if (!bk.isSeparator()) {
-        // add bookmark to url map
-        m_bk_map[bk.internalElement().attribute("href")].append(bk);
-    }
-}
-
 /*
  * VBookmarkManager::Private
  */
@@ -128,8 +81,15 @@ public:
         m_update(false),
         m_browserEditor(false),
         m_typeExternal(false),
-        m_watcher(0)
-    {}
+        m_watcher(0),
+        m_saveDelay(0),
+        m_saveTimer(0),
+        m_modified(false),
+        m_parseFailed(false),
+        m_parseErrorShown(false)
+    {
+        m_index.setDocument(m_doc);
+    }
 
     ~Private() {
         delete m_watcher;
@@ -148,7 +108,14 @@ public:
     bool m_typeExternal;
     QFileSystemWatcher *m_watcher;
 
-    VBookmarkMap m_map;
+    int m_saveDelay;
+    QTimer *m_saveTimer;
+    bool m_modified;
+    QDomElement m_modifiedGroup;
+    bool m_parseFailed;
+    bool m_parseErrorShown;
+
+    VBookmarkIndex m_index;
 };
 
 /*
@@ -300,7 +267,8 @@ void VBookmarkManager::slotFileChanged(const QString &path)
     if (path == d->m_bookmarksFile) {
         qDebug() << "File changed " << path ;
 
-        // Reparse
+        // Save pending changes before they are replaced, then reparse
+        flush();
         parse();
 
         // Tell our GUI
@@ -311,6 +279,8 @@ void VBookmarkManager::slotFileChanged(const QString &path)
 
 VBookmarkManager::~VBookmarkManager()
 {
+    flush();
+
     s_pSelf()->removeAll(this);
 
     delete d;
@@ -335,13 +305,25 @@ void VBookmarkManager::parse() const
 {
     d->m_docIsLoaded = true;
     //qDebug() << "VBookmarkManager::parse " << d->m_bookmarksFile;
+
+    // Reparsing paths flush() first, anything still pending would
+    // refer to the document that is about to be replaced
+    d->m_modified = false;
+    d->m_modifiedGroup = QDomElement();
     QFile file(d->m_bookmarksFile);
     if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "Can't open " << d->m_bookmarksFile;
         return;
     }
     d->m_doc = QDomDocument("xbel");
-    d->m_doc.setContent(&file);
+    VBookmarkXbelReader reader(d->m_doc);
+    // Keep whatever was read so far, but never write it back over
+    // the file we could not fully parse
+    d->m_parseFailed = !reader.read(&file);
+    d->m_parseErrorShown = false;
+    if (d->m_parseFailed)
+        qWarning() << "VBookmarkManager::parse :" << reader.errorString() << d->m_bookmarksFile;
+    d->m_index.setDocument(d->m_doc);
 
     if (d->m_doc.documentElement().isNull()) {
         qWarning() << "VBookmarkManager::parse : main tag is missing, creating default " << d->m_bookmarksFile;
@@ -373,8 +355,6 @@ void VBookmarkManager::parse() const
     d->m_doc.insertBefore(pi, docElem);
 
     file.close();
-
-    d->m_map.setNeedsUpdate();
 }
 
 bool VBookmarkManager::save(bool toolbarCache) const
@@ -386,6 +366,18 @@ bool VBookmarkManager::saveAs(const QString &filename, bool toolbarCache) const
 {
     qDebug() << "VBookmarkManager::save " << filename;
 
+    if (d->m_parseFailed && filename == d->m_bookmarksFile) {
+        qWarning() << "VBookmarkManager::save : refusing to overwrite unparsable file" << filename;
+        if (!d->m_parseErrorShown) {
+            d->m_parseErrorShown = true;
+            emit const_cast<VBookmarkManager *>(this)->error(
+                tr("Unable to save bookmarks in %1 because the file could not be read "
+                   "completely, changes will not be saved until it is fixed. "
+                   "This error message will only be shown once.").arg(filename));
+        }
+        return false;
+    }
+
     // Create the directory if missing
     QFileInfo fileInfo(filename);
     QDir dir = fileInfo.absoluteDir();
@@ -414,11 +406,8 @@ bool VBookmarkManager::saveAs(const QString &filename, bool toolbarCache) const
     VSaveFile file(filename);
     if (file.open()) {
         file.simpleBackupFile(file.fileName(), QString(), ".bak");
-        QTextStream stream(&file);
-        stream.setCodec(QTextCodec::codecForName("UTF-8"));
-        stream << internalDocument().toString();
-        stream.flush();
-        if (file.finalize())
+        VBookmarkXbelWriter writer(internalDocument());
+        if (writer.write(&file) && file.finalize())
             return true;
     }
 
@@ -489,30 +478,25 @@ VBookmarkGroup VBookmarkManager::toolbar()
 
 VBookmark VBookmarkManager::findByAddress(const QString &address)
 {
-    //qDebug() << "VBookmarkManager::findByAddress " << address;
-    VBookmark result = root();
-    // The address is something like /5/10/2+
-    const QStringList addresses = address.split(QRegExp("[/+]"), QString::SkipEmptyParts);
-    // qWarning() << addresses.join(",");
-    for (QStringList::const_iterator it = addresses.begin() ; it != addresses.end() ;) {
-        bool append = ((*it) == "+");
-        uint number = (*it).toUInt();
-        Q_ASSERT(result.isGroup());
-        VBookmarkGroup group = result.toGroup();
-        VBookmark bk = group.first(), lbk = bk; // last non-null bookmark
-        for (uint i = 0 ; ((i < number) || append) && !bk.isNull() ; ++i) {
-            lbk = bk;
-            bk = group.next(bk);
-            //qWarning() << i;
-        }
-        it++;
-        //qWarning() << "found section";
-        result = bk;
-    }
+    // Make sure the document is loaded before looking into the index
+    internalDocument();
+
+    VBookmark result(d->m_index.findByAddress(address));
     if (result.isNull()) {
         qWarning() << "VBookmarkManager::findByAddress: couldn't find item " << address;
     }
-    //qWarning() << "found " << result.address();
+    return result;
+}
+
+QList<VBookmark> VBookmarkManager::search(const QString &text, int maximum)
+{
+    // Make sure the document is loaded before looking into the index
+    internalDocument();
+
+    QList<VBookmark> result;
+    const QList<QDomElement> elements = d->m_index.search(text, maximum);
+    for (int i = 0; i < elements.size(); ++i)
+        result.append(VBookmark(elements.at(i)));
     return result;
 }
 
@@ -522,8 +506,37 @@ void VBookmarkManager::emitChanged()
 }
 
 
+static QDomElement commonAncestor(const QDomElement &first, const QDomElement &second)
+{
+    // Bookmark trees are shallow, no need for anything smarter
+    for (QDomNode a = first; !a.isNull(); a = a.parentNode()) {
+        for (QDomNode b = second; !b.isNull(); b = b.parentNode()) {
+            if (a == b)
+                return a.toElement();
+        }
+    }
+
+    return QDomElement();
+}
+
 void VBookmarkManager::emitChanged(const VBookmarkGroup &group)
 {
+    if (d->m_saveDelay > 0) {
+        // Remember the closest group that contains all the changes,
+        // addresses are computed when saving since they may shift
+        if (d->m_modified)
+            d->m_modifiedGroup = commonAncestor(d->m_modifiedGroup, group.internalElement());
+        else
+            d->m_modifiedGroup = group.internalElement();
+        d->m_modified = true;
+
+        // Not restarted on purpose, a steady stream of changes
+        // must not postpone saving forever
+        if (!d->m_saveTimer->isActive())
+            d->m_saveTimer->start(d->m_saveDelay);
+        return;
+    }
+
     (void) save(); // KDE5 TODO: emitChanged should return a bool? Maybe rename it to saveAndEmitChanged?
 
     // Tell the other processes too
@@ -535,6 +548,56 @@ void VBookmarkManager::emitChanged(const VBookmarkGroup &group)
     //emit changed(group);
 }
 
+void VBookmarkManager::setSaveDelay(int msecs)
+{
+    d->m_saveDelay = qMax(0, msecs);
+
+    if (d->m_saveDelay == 0) {
+        flush();
+        return;
+    }
+
+    if (!d->m_saveTimer) {
+        d->m_saveTimer = new QTimer(this);
+        d->m_saveTimer->setSingleShot(true);
+        connect(d->m_saveTimer, SIGNAL(timeout()), this, SLOT(flush()));
+    }
+}
+
+int VBookmarkManager::saveDelay() const
+{
+    return d->m_saveDelay;
+}
+
+bool VBookmarkManager::isModified() const
+{
+    return d->m_modified;
+}
+
+bool VBookmarkManager::flush()
+{
+    if (d->m_saveTimer)
+        d->m_saveTimer->stop();
+
+    if (!d->m_modified)
+        return true;
+
+    // The group might have been deleted in the meantime
+    QString address = d->m_index.address(d->m_modifiedGroup);
+    if (address.isNull())
+        address = root().address();
+
+    d->m_modified = false;
+    d->m_modifiedGroup = QDomElement();
+
+    const bool saved = save();
+
+    // Tell the other processes too
+    emit bookmarksChanged(address);
+
+    return saved;
+}
+
 void VBookmarkManager::emitConfigChanged()
 {
     emit bookmarkConfigChanged();
@@ -549,6 +612,7 @@ void VBookmarkManager::notifyCompleteChange(const QString &caller) // DBUS call
 
     // The bk editor tells us we should reload everything
     // Reparse
+    flush();
     parse();
 
     // Tell our GUI
@@ -559,6 +623,7 @@ void VBookmarkManager::notifyCompleteChange(const QString &caller) // DBUS call
 void VBookmarkManager::notifyConfigChanged() // DBUS call
 {
     qDebug() << "reloaded bookmark config!";
+    flush();
     parse(); // reload, and thusly recreate the menus
     emit configChanged();
 }
@@ -571,8 +636,10 @@ void VBookmarkManager::notifyChanged(const QString &groupAddress, const QDBusMes
 
     // Reparse (the whole file, no other choice)
     // if someone else notified us
-    if (msg.service() != QDBusConnection::sessionBus().baseService())
+    if (msg.service() != QDBusConnection::sessionBus().baseService()) {
+        flush();
         parse();
+    }
 
     //qDebug() << "VBookmarkManager::notifyChanged " << groupAddress;
     //VBookmarkGroup group = findByAddress(groupAddress).toGroup();
@@ -583,23 +650,26 @@ void VBookmarkManager::notifyChanged(const QString &groupAddress, const QDBusMes
 ///////
 bool VBookmarkManager::updateAccessMetadata(const QString &url)
 {
-    d->m_map.update(this);
-    QList<VBookmark> list = d->m_map.find(url);
+    // Make sure the document is loaded
+    internalDocument();
+
+    QList<QDomElement> list = d->m_index.findByUrl(url);
     if (list.count() == 0)
         return false;
 
-    for (QList<VBookmark>::iterator it = list.begin();
+    for (QList<QDomElement>::iterator it = list.begin();
             it != list.end(); ++it)
-        (*it).updateAccessMetadata();
+        VBookmark(*it).updateAccessMetadata();
 
     return true;
 }
 
 void VBookmarkManager::updateFavicon(const QString &url, const QString &/*faviconurl*/)
 {
-    d->m_map.update(this);
-    QList<VBookmark> list = d->m_map.find(url);
-    for (QList<VBookmark>::iterator it = list.begin();
+    internalDocument();
+
+    QList<QDomElement> list = d->m_index.findByUrl(url);
+    for (QList<QDomElement>::iterator it = list.begin();
             it != list.end(); ++it) {
         // TODO - update favicon data based on faviconurl
         //        but only when the previously used icon
@@ -148,6 +148,21 @@ public:
      */
     VBookmark findByAddress(const QString &address);
 
+    /**
+     * Searches bookmarks by title, URL and description.
+     * Every word of @p text must be found in one of them, words shorter
+     * than three characters only match the beginning of a word while
+     * longer ones match anywhere.  The search is case insensitive.
+     *
+     * The index is built on first use and kept up to date as bookmarks
+     * are changed through the VBookmark API.
+     *
+     * @param text the words to look for
+     * @param maximum the maximum number of results, -1 for no limit
+     * @return the matching bookmarks, in the order they were loaded or added
+     */
+    QList<VBookmark> search(const QString &text, int maximum = -1);
+
     /**
      * Saves the bookmark file and notifies everyone.
      *
@@ -165,12 +180,36 @@ public:
      * You should use emitChanged() instead of this function, it saves
      * and notifies everyone that the file has changed.
      * Only use this if you don't want the emitChanged signal.
+     * A bookmarks file that could not be read completely is never
+     * overwritten, error() is emitted instead.
      * @param toolbarCache iff true save a cache of the toolbar folder, too
      * @return true if saving was successful
      */
     // TODO: Use an enum and not a bool
     bool save(bool toolbarCache = true) const;
 
+    /**
+     * Sets how long, in milliseconds, emitChanged() waits before saving.
+     * Changes made within the delay are saved at once and announced with
+     * a single notification for the closest group containing all of them.
+     * The default of 0 saves and notifies on every call.
+     * Pending changes are also saved before the file is reloaded.
+     * @param msecs the delay in milliseconds
+     */
+    void setSaveDelay(int msecs);
+
+    /**
+     * @return the delay before changes are saved
+     * @see setSaveDelay()
+     */
+    int saveDelay() const;
+
+    /**
+     * @return true if there are changes waiting to be saved
+     * @see setSaveDelay()
+     */
+    bool isModified() const;
+
     void emitConfigChanged();
 
     /**
@@ -236,6 +275,14 @@ public slots:
 
     void notifyConfigChanged();
 
+    /**
+     * Saves the changes that are waiting for the save delay to elapse
+     * and notifies everyone, does nothing if there are none.
+     * @return true if saving was successful or there was nothing to save
+     * @see setSaveDelay()
+     */
+    bool flush();
+
 Q_SIGNALS:
     /**
      * Signal send over DBUS
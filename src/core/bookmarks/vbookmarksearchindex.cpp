@@ -0,0 +1,243 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#include <QtCore/QtAlgorithms>
+
+#include "vbookmarksearchindex_p.h"
+
+// Separates title, URL and description in the indexed text, it never
+// shows up in a query so matches can't span over two fields
+static const QChar s_fieldSeparator = QLatin1Char('\n');
+
+/*
+ * VBookmarkSearchIndex
+ */
+
+VBookmarkSearchIndex::VBookmarkSearchIndex()
+{
+}
+
+void VBookmarkSearchIndex::insert(quint32 id, const QString &title, const QString &url,
+                                  const QString &description)
+{
+    remove(id);
+
+    Entry entry;
+    entry.text = normalized(title) + s_fieldSeparator +
+                 normalized(url) + s_fieldSeparator +
+                 normalized(description);
+    entry.words = words(entry.text);
+
+    for (int i = 0; i < entry.words.size(); ++i)
+        m_words[entry.words.at(i)].insert(id);
+
+    const QSet<Trigram> keys = trigrams(entry.text);
+    for (QSet<Trigram>::const_iterator it = keys.constBegin(); it != keys.constEnd(); ++it)
+        m_trigrams[*it].insert(id);
+
+    m_entries.insert(id, entry);
+}
+
+void VBookmarkSearchIndex::remove(quint32 id)
+{
+    QHash<quint32, Entry>::iterator entry = m_entries.find(id);
+    if (entry == m_entries.end())
+        return;
+
+    const QStringList &entryWords = entry.value().words;
+    for (int i = 0; i < entryWords.size(); ++i) {
+        QMap<QString, QSet<quint32> >::iterator it = m_words.find(entryWords.at(i));
+        if (it == m_words.end())
+            continue;
+        it.value().remove(id);
+        if (it.value().isEmpty())
+            m_words.erase(it);
+    }
+
+    const QSet<Trigram> keys = trigrams(entry.value().text);
+    for (QSet<Trigram>::const_iterator key = keys.constBegin(); key != keys.constEnd(); ++key) {
+        QHash<Trigram, QSet<quint32> >::iterator it = m_trigrams.find(*key);
+        if (it == m_trigrams.end())
+            continue;
+        it.value().remove(id);
+        if (it.value().isEmpty())
+            m_trigrams.erase(it);
+    }
+
+    m_entries.erase(entry);
+}
+
+void VBookmarkSearchIndex::clear()
+{
+    m_entries.clear();
+    m_words.clear();
+    m_trigrams.clear();
+}
+
+int VBookmarkSearchIndex::count() const
+{
+    return m_entries.size();
+}
+
+QVector<quint32> VBookmarkSearchIndex::search(const QString &text, int maximum) const
+{
+    QVector<quint32> result;
+
+    const QStringList terms = normalized(text).simplified().split(QLatin1Char(' '),
+                                                                   QString::SkipEmptyParts);
+    if (terms.isEmpty())
+        return result;
+
+    // Start from the longest term, it's likely the most selective one
+    int longest = 0;
+    for (int i = 1; i < terms.size(); ++i) {
+        if (terms.at(i).size() > terms.at(longest).size())
+            longest = i;
+    }
+
+    const QString &first = terms.at(longest);
+    const QSet<quint32> candidates = first.size() >= 3 ?
+                                     substringMatches(first) : wordMatches(first);
+
+    for (QSet<quint32>::const_iterator id = candidates.constBegin(); id != candidates.constEnd(); ++id) {
+        const Entry &entry = m_entries.constFind(*id).value();
+
+        bool matchesAll = true;
+        for (int i = 0; i < terms.size() && matchesAll; ++i) {
+            if (i != longest)
+                matchesAll = matches(entry, terms.at(i));
+        }
+
+        if (matchesAll)
+            result.append(*id);
+    }
+
+    qSort(result);
+    if (maximum >= 0 && result.size() > maximum)
+        result.resize(maximum);
+    return result;
+}
+
+QString VBookmarkSearchIndex::normalized(const QString &text)
+{
+    return text.toCaseFolded();
+}
+
+QStringList VBookmarkSearchIndex::words(const QString &text)
+{
+    QStringList result;
+
+    int start = -1;
+    for (int i = 0; i <= text.size(); ++i) {
+        const bool isWordCharacter = i < text.size() && text.at(i).isLetterOrNumber();
+        if (isWordCharacter && start < 0) {
+            start = i;
+        } else if (!isWordCharacter && start >= 0) {
+            result.append(text.mid(start, i - start));
+            start = -1;
+        }
+    }
+
+    result.removeDuplicates();
+    return result;
+}
+
+QSet<VBookmarkSearchIndex::Trigram> VBookmarkSearchIndex::trigrams(const QString &text)
+{
+    QSet<Trigram> result;
+
+    const QChar *c = text.constData();
+    for (int i = 0; i + 2 < text.size(); ++i) {
+        if (c[i] == s_fieldSeparator || c[i + 1] == s_fieldSeparator ||
+                c[i + 2] == s_fieldSeparator)
+            continue;
+
+        result.insert((Trigram(c[i].unicode()) << 32) |
+                      (Trigram(c[i + 1].unicode()) << 16) |
+                      Trigram(c[i + 2].unicode()));
+    }
+
+    return result;
+}
+
+QSet<quint32> VBookmarkSearchIndex::wordMatches(const QString &prefix) const
+{
+    QSet<quint32> result;
+
+    QMap<QString, QSet<quint32> >::const_iterator it = m_words.lowerBound(prefix);
+    for (; it != m_words.constEnd() && it.key().startsWith(prefix); ++it)
+        result.unite(it.value());
+
+    return result;
+}
+
+QSet<quint32> VBookmarkSearchIndex::substringMatches(const QString &term) const
+{
+    QSet<quint32> result;
+
+    // Every trigram of the term has to be there, start from the rarest
+    QVector<const QSet<quint32> *> postings;
+    const QSet<Trigram> keys = trigrams(term);
+    for (QSet<Trigram>::const_iterator key = keys.constBegin(); key != keys.constEnd(); ++key) {
+        QHash<Trigram, QSet<quint32> >::const_iterator it = m_trigrams.constFind(*key);
+        if (it == m_trigrams.constEnd())
+            return result;
+
+        postings.append(&it.value());
+        if (postings.last()->size() < postings.first()->size())
+            qSwap(postings.first(), postings.last());
+    }
+
+    if (postings.isEmpty())
+        return result;
+
+    const QSet<quint32> &rarest = *postings.first();
+    for (QSet<quint32>::const_iterator id = rarest.constBegin(); id != rarest.constEnd(); ++id) {
+        bool inAll = true;
+        for (int i = 1; i < postings.size() && inAll; ++i)
+            inAll = postings.at(i)->contains(*id);
+
+        // Trigrams can match out of order, check the actual text
+        if (inAll && m_entries.constFind(*id).value().text.contains(term))
+            result.insert(*id);
+    }
+
+    return result;
+}
+
+bool VBookmarkSearchIndex::matches(const Entry &entry, const QString &term) const
+{
+    if (term.size() >= 3)
+        return entry.text.contains(term);
+
+    for (int i = 0; i < entry.words.size(); ++i) {
+        if (entry.words.at(i).startsWith(term))
+            return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,92 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#ifndef VBOOKMARKSEARCHINDEX_P_H
+#define VBOOKMARKSEARCHINDEX_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Vibe API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+/*
+ * Full text index over bookmark titles, URLs and descriptions.
+ *
+ * Words are kept in a sorted map for prefix queries, and every three
+ * characters sequence points to the entries containing it so that
+ * substring queries only look at a handful of candidates.
+ */
+class VBookmarkSearchIndex
+{
+public:
+    VBookmarkSearchIndex();
+
+    // Adds or replaces an entry
+    void insert(quint32 id, const QString &title, const QString &url,
+                const QString &description);
+    void remove(quint32 id);
+    void clear();
+
+    int count() const;
+
+    // Entries matching all the words of text, sorted by id
+    QVector<quint32> search(const QString &text, int maximum = -1) const;
+
+private:
+    typedef quint64 Trigram;
+
+    struct Entry {
+        QString text;
+        QStringList words;
+    };
+
+    static QString normalized(const QString &text);
+    static QStringList words(const QString &text);
+    static QSet<Trigram> trigrams(const QString &text);
+
+    QSet<quint32> wordMatches(const QString &prefix) const;
+    QSet<quint32> substringMatches(const QString &term) const;
+    bool matches(const Entry &entry, const QString &term) const;
+
+    QHash<quint32, Entry> m_entries;
+    QMap<QString, QSet<quint32> > m_words;
+    QHash<Trigram, QSet<quint32> > m_trigrams;
+};
+
+#endif // VBOOKMARKSEARCHINDEX_P_H
@@ -0,0 +1,224 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#include <QtCore/QIODevice>
+#include <QtCore/QXmlStreamReader>
+#include <QtCore/QXmlStreamWriter>
+
+#include "vbookmarkxbel_p.h"
+
+/*
+ * VBookmarkXbelReader
+ */
+
+VBookmarkXbelReader::VBookmarkXbelReader(QDomDocument &document)
+    : m_document(document)
+{
+}
+
+bool VBookmarkXbelReader::read(QIODevice *device)
+{
+    QXmlStreamReader reader(device);
+
+    // Keep prefixed names such as bookmark:icon as they are, this is
+    // what QDomDocument::setContent() does and what VBookmark expects
+    reader.setNamespaceProcessing(false);
+
+    QDomNode current = m_document;
+    while (!reader.atEnd()) {
+        switch (reader.readNext()) {
+        case QXmlStreamReader::StartElement: {
+            QDomElement element = m_document.createElement(reader.qualifiedName().toString());
+
+            const QXmlStreamNamespaceDeclarations namespaces = reader.namespaceDeclarations();
+            for (int i = 0; i < namespaces.size(); ++i) {
+                const QXmlStreamNamespaceDeclaration &ns = namespaces.at(i);
+                if (ns.prefix().isEmpty())
+                    element.setAttribute(QLatin1String("xmlns"), ns.namespaceUri().toString());
+                else
+                    element.setAttribute(QLatin1String("xmlns:") + ns.prefix().toString(),
+                                         ns.namespaceUri().toString());
+            }
+
+            const QXmlStreamAttributes attributes = reader.attributes();
+            for (int i = 0; i < attributes.size(); ++i) {
+                const QXmlStreamAttribute &attribute = attributes.at(i);
+                element.setAttribute(attribute.qualifiedName().toString(),
+                                     attribute.value().toString());
+            }
+
+            current.appendChild(element);
+            current = element;
+            break;
+        }
+        case QXmlStreamReader::EndElement:
+            current = current.parentNode();
+            break;
+        case QXmlStreamReader::Characters:
+            if (reader.isCDATA()) {
+                current.appendChild(m_document.createCDATASection(reader.text().toString()));
+            } else if (!reader.isWhitespace()) {
+                // Text might be reported in more than one chunk
+                QDomText text = current.lastChild().toText();
+                if (!text.isNull() && !text.isCDATASection())
+                    text.appendData(reader.text().toString());
+                else
+                    current.appendChild(m_document.createTextNode(reader.text().toString()));
+            }
+            break;
+        case QXmlStreamReader::Comment:
+            current.appendChild(m_document.createComment(reader.text().toString()));
+            break;
+        case QXmlStreamReader::ProcessingInstruction:
+            current.appendChild(m_document.createProcessingInstruction(
+                                    reader.processingInstructionTarget().toString(),
+                                    reader.processingInstructionData().toString()));
+            break;
+        case QXmlStreamReader::EntityReference:
+            // Entities that couldn't be resolved are kept as they are
+            current.appendChild(m_document.createEntityReference(reader.name().toString()));
+            break;
+        case QXmlStreamReader::DTD:
+            readDoctype(reader);
+            current = m_document;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (reader.hasError()) {
+        m_errorString = QString("%1 at line %2, column %3")
+                        .arg(reader.errorString())
+                        .arg(reader.lineNumber())
+                        .arg(reader.columnNumber());
+        return false;
+    }
+
+    return true;
+}
+
+void VBookmarkXbelReader::readDoctype(QXmlStreamReader &reader)
+{
+    // QDom only builds a doctype, with its ids and internal subset,
+    // while parsing, so parse the declaration on its own; it comes
+    // before the document element, only a few nodes need moving
+    QDomDocument document;
+    const QString content = reader.text().toString() +
+                            QString("<%1/>").arg(reader.dtdName().toString());
+    if (!document.setContent(content))
+        return;
+    document.removeChild(document.documentElement());
+
+    for (QDomNode node = m_document.firstChild(); !node.isNull(); node = node.nextSibling())
+        document.appendChild(document.importNode(node, true));
+    m_document = document;
+}
+
+QString VBookmarkXbelReader::errorString() const
+{
+    return m_errorString;
+}
+
+/*
+ * VBookmarkXbelWriter
+ */
+
+VBookmarkXbelWriter::VBookmarkXbelWriter(const QDomDocument &document)
+    : m_document(document)
+{
+}
+
+bool VBookmarkXbelWriter::write(QIODevice *device)
+{
+    QXmlStreamWriter writer(device);
+    writer.setCodec("UTF-8");
+    writer.setAutoFormatting(true);
+    writer.setAutoFormattingIndent(1);
+
+    writer.writeStartDocument();
+    // QDom does not list the doctype among the document children
+    const QDomDocumentType doctype = m_document.doctype();
+    if (!doctype.name().isEmpty()) {
+        QString dtd = QString("<!DOCTYPE %1").arg(doctype.name());
+        if (!doctype.publicId().isEmpty())
+            dtd += QString(" PUBLIC \"%1\" \"%2\"").arg(doctype.publicId(), doctype.systemId());
+        else if (!doctype.systemId().isEmpty())
+            dtd += QString(" SYSTEM \"%1\"").arg(doctype.systemId());
+        if (!doctype.internalSubset().isEmpty())
+            dtd += QString(" [%1]").arg(doctype.internalSubset());
+        writer.writeDTD(dtd + QLatin1Char('>'));
+    }
+    for (QDomNode node = m_document.firstChild(); !node.isNull(); node = node.nextSibling())
+        writeNode(writer, node);
+    writer.writeEndDocument();
+
+    return !writer.hasError();
+}
+
+void VBookmarkXbelWriter::writeNode(QXmlStreamWriter &writer, const QDomNode &node)
+{
+    switch (node.nodeType()) {
+    case QDomNode::ElementNode: {
+        const QDomElement element = node.toElement();
+        writer.writeStartElement(element.tagName());
+
+        const QDomNamedNodeMap attributes = element.attributes();
+        for (int i = 0; i < attributes.count(); ++i) {
+            const QDomAttr attribute = attributes.item(i).toAttr();
+            writer.writeAttribute(attribute.name(), attribute.value());
+        }
+
+        for (QDomNode child = element.firstChild(); !child.isNull(); child = child.nextSibling())
+            writeNode(writer, child);
+
+        writer.writeEndElement();
+        break;
+    }
+    case QDomNode::TextNode:
+        writer.writeCharacters(node.toText().data());
+        break;
+    case QDomNode::CDATASectionNode:
+        writer.writeCDATA(node.toCDATASection().data());
+        break;
+    case QDomNode::CommentNode:
+        writer.writeComment(node.toComment().data());
+        break;
+    case QDomNode::EntityReferenceNode:
+        writer.writeEntityReference(node.nodeName());
+        break;
+    case QDomNode::ProcessingInstructionNode: {
+        // The XML declaration is written by writeStartDocument()
+        const QDomProcessingInstruction pi = node.toProcessingInstruction();
+        if (pi.target() != QLatin1String("xml"))
+            writer.writeProcessingInstruction(pi.target(), pi.data());
+        break;
+    }
+    default:
+        break;
+    }
+}
@@ -0,0 +1,86 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#ifndef VBOOKMARKXBEL_P_H
+#define VBOOKMARKXBEL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Vibe API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QString>
+#include <QtXml/QDomDocument>
+
+class QIODevice;
+class QXmlStreamReader;
+class QXmlStreamWriter;
+
+/*
+ * Reads XBEL into a QDomDocument with a QXmlStreamReader, straight from
+ * the device instead of loading the whole file first.  The resulting
+ * document is still held in memory as a whole.
+ */
+class VBookmarkXbelReader
+{
+public:
+    explicit VBookmarkXbelReader(QDomDocument &document);
+
+    bool read(QIODevice *device);
+    QString errorString() const;
+
+private:
+    void readDoctype(QXmlStreamReader &reader);
+
+    QDomDocument &m_document;
+    QString m_errorString;
+};
+
+/*
+ * Writes a QDomDocument to a device with a QXmlStreamWriter, without
+ * serializing the whole document to a string first.
+ */
+class VBookmarkXbelWriter
+{
+public:
+    explicit VBookmarkXbelWriter(const QDomDocument &document);
+
+    bool write(QIODevice *device);
+
+private:
+    void writeNode(QXmlStreamWriter &writer, const QDomNode &node);
+
+    QDomDocument m_document;
+};
+
+#endif // VBOOKMARKXBEL_P_H
@@ -27,16 +27,19 @@
  * $END_LICENSE$
  ***************************************************************************/
 
+#include <QMap>
+
 #include "vcompositejob.h"
 #include "vcompositejob_p.h"
 
 VCompositeJobPrivate::VCompositeJobPrivate()
+    : nextSerial(0), orderedSubjobsDirty(false)
 {
 }
 
 VCompositeJobPrivate::~VCompositeJobPrivate()
 {
-    qDeleteAll(subjobs);
+    qDeleteAll(subjobs.keys());
 }
 
 VCompositeJob::VCompositeJob(QObject *parent)
@@ -59,7 +62,9 @@ bool VCompositeJob::addSubjob(VJob *job)
     if (job == 0 || d->subjobs.contains(job))
         return false;
 
-    d->subjobs.append(job);
+    d->subjobs.insert(job, d->nextSerial++);
+    if (!d->orderedSubjobsDirty)
+        d->orderedSubjobs.append(job);
 
     connect(job, SIGNAL(result(VJob *)),
             SLOT(slotResult(VJob *)));
@@ -77,7 +82,8 @@ bool VCompositeJob::removeSubjob(VJob *job)
     if (job == 0)
         return false;
 
-    d->subjobs.removeAll(job);
+    if (d->subjobs.remove(job) > 0)
+        d->orderedSubjobsDirty = true;
 
     return true;
 }
@@ -89,13 +95,32 @@ bool VCompositeJob::hasSubjobs() const
 
 const QList<VJob *> &VCompositeJob::subjobs() const
 {
-    return d_func()->subjobs;
+    Q_D(const VCompositeJob);
+
+    if (d->orderedSubjobsDirty) {
+        QMap<quint64, VJob *> ordered;
+        QHash<VJob *, quint64>::const_iterator it;
+        for (it = d->subjobs.constBegin(); it != d->subjobs.constEnd(); ++it)
+            ordered.insert(it.value(), it.key());
+
+        d->orderedSubjobs = ordered.values();
+        d->orderedSubjobsDirty = false;
+    }
+
+    return d->orderedSubjobs;
+}
+
+bool VCompositeJob::containsSubjob(VJob *job) const
+{
+    return d_func()->subjobs.contains(job);
 }
 
 void VCompositeJob::clearSubjobs()
 {
     Q_D(VCompositeJob);
     d->subjobs.clear();
+    d->orderedSubjobs.clear();
+    d->orderedSubjobsDirty = false;
 }
 
 void VCompositeJob::slotResult(VJob *job)
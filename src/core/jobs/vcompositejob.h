@@ -90,6 +90,14 @@ protected:
      */
     const QList<VJob *> &subjobs() const;
 
+    /**
+     * Checks if a job is a subjob of this job, in constant time.
+     *
+     * @param job the job
+     * @return true if @p job has been added and not removed yet
+     */
+    bool containsSubjob(VJob *job) const;
+
     /**
      * Clears the list of subjobs.
      */
@@ -30,6 +30,8 @@
 #ifndef VCOMPOSITEJOB_P_H
 #define VCOMPOSITEJOB_P_H
 
+#include <QHash>
+
 #include "vcompositejob.h"
 #include "vjob_p.h"
 
@@ -50,7 +52,12 @@ public:
     VCompositeJobPrivate();
     ~VCompositeJobPrivate();
 
-    QList<VJob *> subjobs;
+    // Subjobs keyed to their insertion serial, the ordered list
+    // returned by subjobs() is rebuilt lazily after removals
+    QHash<VJob *, quint64> subjobs;
+    quint64 nextSerial;
+    mutable QList<VJob *> orderedSubjobs;
+    mutable bool orderedSubjobsDirty;
 
     Q_DECLARE_PUBLIC(VCompositeJob)
 };
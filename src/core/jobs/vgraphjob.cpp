@@ -0,0 +1,385 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#include <QSet>
+#include <QThread>
+#include <QTimer>
+
+#include "vgraphjob.h"
+#include "vgraphjob_p.h"
+
+/*
+ * VGraphJobPrivate
+ */
+
+VGraphJobPrivate::VGraphJobPrivate()
+    : maximumRunning(QThread::idealThreadCount()), running(0),
+      started(false), abortOnError(true)
+{
+    for (int i = 0; i < UnitCount; ++i)
+        processedSum[i] = totalSum[i] = 0;
+}
+
+VGraphJobPrivate::~VGraphJobPrivate()
+{
+}
+
+void VGraphJobPrivate::dispatch()
+{
+    while (!ready.isEmpty() && !suspended && !isFinished &&
+            (maximumRunning <= 0 || running < maximumRunning)) {
+        VJob *job = ready.dequeue();
+        nodes[job].running = true;
+        running++;
+        job->start();
+    }
+}
+
+void VGraphJobPrivate::dropRemainingAmounts(Node &node)
+{
+    // What won't be processed must not count in the totals either,
+    // or the percentage never reaches 100
+    for (int i = 0; i < UnitCount; ++i) {
+        totalSum[i] -= node.total[i] - node.processed[i];
+        node.total[i] = node.processed[i];
+    }
+}
+
+void VGraphJobPrivate::skipDependents(VJob *job)
+{
+    Q_Q(VGraphJob);
+
+    QHash<VJob *, Node>::iterator failed = nodes.find(job);
+    if (failed == nodes.end())
+        return;
+    dropRemainingAmounts(failed.value());
+
+    // Dependents can't be running nor ready since one of
+    // their prerequisites failed, so we just drop them
+    QSet<VJob *> skipped;
+    QQueue<VJob *> queue;
+    queue.append(failed.value().dependents);
+
+    while (!queue.isEmpty()) {
+        VJob *dependent = queue.dequeue();
+
+        QHash<VJob *, Node>::iterator it = nodes.find(dependent);
+        if (it == nodes.end())
+            continue;
+
+        queue.append(it.value().dependents);
+        dropRemainingAmounts(it.value());
+        nodes.erase(it);
+        skipped.insert(dependent);
+
+        QObject::disconnect(dependent, 0, q, 0);
+        q->VCompositeJob::removeSubjob(dependent);
+        dependent->deleteLater();
+    }
+
+    // Other prerequisites of the skipped jobs are still in the graph
+    if (!skipped.isEmpty()) {
+        for (QHash<VJob *, Node>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+            QList<VJob *> &dependents = it.value().dependents;
+            for (int i = dependents.size() - 1; i >= 0; --i) {
+                if (skipped.contains(dependents.at(i)))
+                    dependents.removeAt(i);
+            }
+        }
+    }
+
+    for (int i = 0; i < UnitCount; ++i)
+        q->setTotalAmount(static_cast<VJob::Unit>(i), totalSum[i]);
+}
+
+void VGraphJobPrivate::abort()
+{
+    Q_Q(VGraphJob);
+
+    QHash<VJob *, Node>::const_iterator it;
+    for (it = nodes.constBegin(); it != nodes.constEnd(); ++it) {
+        VJob *job = it.key();
+
+        QObject::disconnect(job, 0, q, 0);
+        q->VCompositeJob::removeSubjob(job);
+
+        // Jobs that can't be killed will delete themselves when done
+        if (it.value().running)
+            job->kill(VJob::Quietly);
+        else
+            job->deleteLater();
+    }
+
+    nodes.clear();
+    ready.clear();
+    running = 0;
+}
+
+void VGraphJobPrivate::checkDone()
+{
+    Q_Q(VGraphJob);
+
+    if (started && !isFinished && running == 0 && ready.isEmpty())
+        q->emitResult();
+}
+
+void VGraphJobPrivate::_q_start()
+{
+    if (isFinished)
+        return;
+
+    started = true;
+    dispatch();
+    checkDone();
+}
+
+void VGraphJobPrivate::_q_subjobTotalAmount(VJob *job, VJob::Unit unit, qulonglong amount)
+{
+    Q_Q(VGraphJob);
+
+    QHash<VJob *, Node>::iterator it = nodes.find(job);
+    if (it == nodes.end() || int(unit) >= UnitCount)
+        return;
+
+    // Unsigned arithmetic wraps around, so this works when the amount shrinks too
+    totalSum[unit] += amount - it.value().total[unit];
+    it.value().total[unit] = amount;
+    q->setTotalAmount(unit, totalSum[unit]);
+}
+
+void VGraphJobPrivate::_q_subjobProcessedAmount(VJob *job, VJob::Unit unit, qulonglong amount)
+{
+    Q_Q(VGraphJob);
+
+    QHash<VJob *, Node>::iterator it = nodes.find(job);
+    if (it == nodes.end() || int(unit) >= UnitCount)
+        return;
+
+    processedSum[unit] += amount - it.value().processed[unit];
+    it.value().processed[unit] = amount;
+    q->setProcessedAmount(unit, processedSum[unit]);
+}
+
+/*
+ * VGraphJob
+ */
+
+VGraphJob::VGraphJob(QObject *parent)
+    : VCompositeJob(*new VGraphJobPrivate, parent)
+{
+    setCapabilities(Killable | Suspendable);
+}
+
+VGraphJob::VGraphJob(VGraphJobPrivate &dd, QObject *parent)
+    : VCompositeJob(dd, parent)
+{
+    setCapabilities(Killable | Suspendable);
+}
+
+VGraphJob::~VGraphJob()
+{
+}
+
+bool VGraphJob::addJob(VJob *job, const QList<VJob *> &prerequisites)
+{
+    Q_D(VGraphJob);
+
+    if (job == 0 || d->nodes.contains(job))
+        return false;
+
+    foreach (VJob *prerequisite, prerequisites) {
+        if (!d->nodes.contains(prerequisite))
+            return false;
+    }
+
+    if (!VCompositeJob::addSubjob(job))
+        return false;
+
+    foreach (VJob *prerequisite, prerequisites)
+        d->nodes[prerequisite].dependents.append(job);
+
+    VGraphJobPrivate::Node node;
+    node.pendingPrerequisites = prerequisites.size();
+    d->nodes.insert(job, node);
+
+    connect(job, SIGNAL(totalAmount(VJob *, VJob::Unit, qulonglong)),
+            SLOT(_q_subjobTotalAmount(VJob *, VJob::Unit, qulonglong)));
+    connect(job, SIGNAL(processedAmount(VJob *, VJob::Unit, qulonglong)),
+            SLOT(_q_subjobProcessedAmount(VJob *, VJob::Unit, qulonglong)));
+
+    if (node.pendingPrerequisites == 0) {
+        d->ready.enqueue(job);
+        if (d->started)
+            d->dispatch();
+    }
+
+    return true;
+}
+
+int VGraphJob::maximumRunningJobs() const
+{
+    Q_D(const VGraphJob);
+    return d->maximumRunning;
+}
+
+void VGraphJob::setMaximumRunningJobs(int maximum)
+{
+    Q_D(VGraphJob);
+    d->maximumRunning = qMax(maximum, 0);
+    if (d->started)
+        d->dispatch();
+}
+
+bool VGraphJob::abortOnError() const
+{
+    Q_D(const VGraphJob);
+    return d->abortOnError;
+}
+
+void VGraphJob::setAbortOnError(bool abort)
+{
+    Q_D(VGraphJob);
+    d->abortOnError = abort;
+}
+
+void VGraphJob::start()
+{
+    QTimer::singleShot(0, this, SLOT(_q_start()));
+}
+
+bool VGraphJob::addSubjob(VJob *job)
+{
+    return addJob(job);
+}
+
+bool VGraphJob::removeSubjob(VJob *job)
+{
+    Q_D(VGraphJob);
+
+    if (!VCompositeJob::removeSubjob(job))
+        return false;
+
+    QHash<VJob *, VGraphJobPrivate::Node>::iterator it = d->nodes.find(job);
+    if (it == d->nodes.end())
+        return true;
+
+    const VGraphJobPrivate::Node node = it.value();
+    d->nodes.erase(it);
+    disconnect(job, 0, this, 0);
+
+    if (node.running)
+        d->running--;
+    else
+        d->ready.removeOne(job);
+
+    // A removed subjob counts as done
+    foreach (VJob *dependent, node.dependents) {
+        QHash<VJob *, VGraphJobPrivate::Node>::iterator dep = d->nodes.find(dependent);
+        if (dep != d->nodes.end() && --dep.value().pendingPrerequisites == 0)
+            d->ready.enqueue(dependent);
+    }
+
+    if (d->started) {
+        d->dispatch();
+        d->checkDone();
+    }
+
+    return true;
+}
+
+bool VGraphJob::doKill()
+{
+    Q_D(VGraphJob);
+    d->abort();
+    return true;
+}
+
+bool VGraphJob::doSuspend()
+{
+    Q_D(VGraphJob);
+
+    QHash<VJob *, VGraphJobPrivate::Node>::const_iterator it;
+    for (it = d->nodes.constBegin(); it != d->nodes.constEnd(); ++it) {
+        if (it.value().running)
+            it.key()->suspend();
+    }
+
+    return true;
+}
+
+bool VGraphJob::doResume()
+{
+    Q_D(VGraphJob);
+
+    QHash<VJob *, VGraphJobPrivate::Node>::const_iterator it;
+    for (it = d->nodes.constBegin(); it != d->nodes.constEnd(); ++it) {
+        if (it.value().running)
+            it.key()->resume();
+    }
+
+    // Start the jobs that became ready in the meantime, once
+    // the suspended flag has been cleared
+    if (d->started)
+        QTimer::singleShot(0, this, SLOT(_q_start()));
+
+    return true;
+}
+
+void VGraphJob::slotResult(VJob *job)
+{
+    Q_D(VGraphJob);
+
+    if (!d->nodes.contains(job)) {
+        VCompositeJob::removeSubjob(job);
+        return;
+    }
+
+    if (job->error()) {
+        // Store it in the parent only if first error
+        if (!error()) {
+            setError(job->error());
+            setErrorText(job->errorText());
+        }
+
+        if (d->abortOnError) {
+            d->nodes.remove(job);
+            disconnect(job, 0, this, 0);
+            VCompositeJob::removeSubjob(job);
+            d->running--;
+
+            d->abort();
+            emitResult();
+            return;
+        }
+
+        d->skipDependents(job);
+    }
+
+    removeSubjob(job);
+}
+
+#include "moc_vgraphjob.cpp"
@@ -0,0 +1,152 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#ifndef VGRAPHJOB_H
+#define VGRAPHJOB_H
+
+#include <VibeCore/VibeCoreExport>
+#include <VibeCore/VCompositeJob>
+
+class VGraphJobPrivate;
+
+/**
+ * A composite job whose subjobs form a dependency graph.
+ *
+ * Each subjob can declare prerequisites, subjobs that must finish
+ * successfully before it is started.  Subjobs whose prerequisites are
+ * met run concurrently, up to maximumRunningJobs() at a time, and the
+ * graph job emits its result when every subjob is done.
+ *
+ * \code
+ * VGraphJob *graph = new VGraphJob(this);
+ * graph->addJob(download1);
+ * graph->addJob(download2);
+ * graph->addJob(extract, QList<VJob *>() << download1 << download2);
+ * graph->addJob(copy, QList<VJob *>() << extract);
+ * graph->start();
+ * \endcode
+ *
+ * Since prerequisites must already be part of the graph when a job is
+ * added, the graph can never contain cycles.
+ *
+ * Total and processed amounts reported by the subjobs are summed up
+ * and reported as the amounts of the graph job.
+ */
+class VIBECORE_EXPORT VGraphJob : public VCompositeJob
+{
+    Q_OBJECT
+public:
+    /**
+     * Creates a new VGraphJob object.
+     *
+     * @param parent the parent QObject
+     */
+    explicit VGraphJob(QObject *parent = 0);
+
+    /**
+     * Destroys a VGraphJob object.
+     */
+    virtual ~VGraphJob();
+
+    /**
+     * Adds a subjob to the graph.
+     *
+     * Prerequisites must have been added to this graph before and must
+     * not be finished yet.  If the graph is already running and the
+     * job has no pending prerequisites, it's started as soon as a slot
+     * is available.
+     *
+     * @param job the subjob to add
+     * @param prerequisites the subjobs that must finish successfully first
+     * @return true if the job has been added, false otherwise
+     */
+    bool addJob(VJob *job, const QList<VJob *> &prerequisites = QList<VJob *>());
+
+    /**
+     * Returns the maximum number of subjobs running at the same time.
+     *
+     * @see setMaximumRunningJobs()
+     */
+    int maximumRunningJobs() const;
+
+    /**
+     * Sets the maximum number of subjobs running at the same time,
+     * a value less than or equal to 0 removes the limit.
+     * The default is QThread::idealThreadCount().
+     *
+     * @param maximum the maximum number of running subjobs
+     */
+    void setMaximumRunningJobs(int maximum);
+
+    /**
+     * Returns whether the graph aborts on the first subjob error.
+     *
+     * @see setAbortOnError()
+     */
+    bool abortOnError() const;
+
+    /**
+     * Sets whether the graph aborts on the first subjob error.
+     *
+     * When true, which is the default, running subjobs are killed and
+     * the result is emitted right away.  When false, only the subjobs
+     * that depend on the failed one, directly or indirectly, are
+     * skipped while the others keep running; the error of the first
+     * failed subjob is reported when the graph is done.  What the failed
+     * and skipped subjobs did not process is removed from the totals.
+     *
+     * @param abort whether to abort on error
+     */
+    void setAbortOnError(bool abort);
+
+    /**
+     * Starts the subjobs that have no prerequisites.
+     */
+    virtual void start();
+
+protected:
+    virtual bool addSubjob(VJob *job);
+    virtual bool removeSubjob(VJob *job);
+
+    virtual bool doKill();
+    virtual bool doSuspend();
+    virtual bool doResume();
+
+protected Q_SLOTS:
+    virtual void slotResult(VJob *job);
+
+protected:
+    VGraphJob(VGraphJobPrivate &dd, QObject *parent);
+
+private:
+    Q_PRIVATE_SLOT(d_func(), void _q_start())
+    Q_PRIVATE_SLOT(d_func(), void _q_subjobTotalAmount(VJob *, VJob::Unit, qulonglong))
+    Q_PRIVATE_SLOT(d_func(), void _q_subjobProcessedAmount(VJob *, VJob::Unit, qulonglong))
+    Q_DECLARE_PRIVATE(VGraphJob)
+};
+
+#endif // VGRAPHJOB_H
@@ -0,0 +1,91 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#ifndef VGRAPHJOB_P_H
+#define VGRAPHJOB_P_H
+
+#include <QQueue>
+
+#include "vgraphjob.h"
+#include "vcompositejob_p.h"
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Vibe API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+class VIBECORE_EXPORT VGraphJobPrivate : public VCompositeJobPrivate
+{
+public:
+    enum { UnitCount = VJob::Directories + 1 };
+
+    struct Node {
+        Node() : pendingPrerequisites(0), running(false) {
+            for (int i = 0; i < UnitCount; ++i)
+                processed[i] = total[i] = 0;
+        }
+
+        QList<VJob *> dependents;
+        int pendingPrerequisites;
+        bool running;
+        qulonglong processed[UnitCount];
+        qulonglong total[UnitCount];
+    };
+
+    VGraphJobPrivate();
+    ~VGraphJobPrivate();
+
+    // Subjobs that are waiting or running, finished ones are removed
+    QHash<VJob *, Node> nodes;
+    QQueue<VJob *> ready;
+    int maximumRunning;
+    int running;
+    bool started;
+    bool abortOnError;
+    qulonglong processedSum[UnitCount];
+    qulonglong totalSum[UnitCount];
+
+    void dispatch();
+    void dropRemainingAmounts(Node &node);
+    void skipDependents(VJob *job);
+    void abort();
+    void checkDone();
+
+    void _q_start();
+    void _q_subjobTotalAmount(VJob *job, VJob::Unit unit, qulonglong amount);
+    void _q_subjobProcessedAmount(VJob *job, VJob::Unit unit, qulonglong amount);
+
+    Q_DECLARE_PUBLIC(VGraphJob)
+};
+
+#endif // VGRAPHJOB_P_H
@@ -46,7 +46,10 @@ VJobPrivate::VJobPrivate()
     : q_ptr(0), uiDelegate(0), error(VJob::NoError),
       progressUnit(VJob::Bytes), percentage(0),
       suspended(false), capabilities(VJob::NoCapabilities),
-      speedTimer(0), isAutoDelete(true), eventLoop(0), isFinished(false)
+      speedTimer(0), isAutoDelete(true), eventLoop(0),
+      progressInterval(0), progressThreshold(0), speedEstimation(false),
+      lastProgressTime(-1), pendingUnits(0), progressTimer(0),
+      isFinished(false)
 {
     if (!_q_kjobUnitEnumRegistered)
         _q_kjobUnitEnumRegistered = qRegisterMetaType<VJob::Unit>("VJob::Unit");
@@ -56,6 +59,152 @@ VJobPrivate::~VJobPrivate()
 {
 }
 
+qint64 VJobPrivate::elapsed()
+{
+    if (!clock.isValid())
+        clock.start();
+    return clock.elapsed();
+}
+
+bool VJobPrivate::isBelowThreshold(VJob::Unit unit, qulonglong amount)
+{
+    if (progressThreshold == 0)
+        return false;
+
+    // Never hold back the final value
+    const qulonglong total = totalAmount.value(unit);
+    if (total > 0 && amount >= total)
+        return false;
+
+    const qulonglong last = emittedAmount.value(unit);
+    const qulonglong delta = amount > last ? amount - last : last - amount;
+    return delta < progressThreshold;
+}
+
+bool VJobPrivate::isProgressThrottled(VJob::Unit unit, qulonglong amount)
+{
+    if (progressInterval <= 0 && progressThreshold == 0)
+        return false;
+
+    // Never hold back the final value
+    const qulonglong total = totalAmount.value(unit);
+    if (total > 0 && amount >= total)
+        return false;
+
+    if (isBelowThreshold(unit, amount))
+        return true;
+
+    if (progressInterval > 0 && lastProgressTime >= 0 &&
+            elapsed() - lastProgressTime < progressInterval)
+        return true;
+
+    return false;
+}
+
+void VJobPrivate::deferProgress(VJob::Unit unit)
+{
+    Q_Q(VJob);
+
+    pendingUnits |= (1 << unit);
+
+    // Without a time interval the pending value will be delivered
+    // by the next update that passes the threshold or on finish
+    if (progressInterval <= 0)
+        return;
+
+    if (!progressTimer) {
+        progressTimer = new QTimer(q);
+        progressTimer->setSingleShot(true);
+        QObject::connect(progressTimer, SIGNAL(timeout()), q, SLOT(_q_progressTimeout()));
+    }
+
+    if (!progressTimer->isActive()) {
+        const qint64 remaining = progressInterval - (elapsed() - lastProgressTime);
+        progressTimer->start(qMax<qint64>(remaining, 0));
+    }
+}
+
+void VJobPrivate::emitProcessedAmount(VJob::Unit unit)
+{
+    Q_Q(VJob);
+
+    const qulonglong amount = processedAmount[unit];
+
+    pendingUnits &= ~(1 << unit);
+    emittedAmount[unit] = amount;
+
+    Q_EMIT q->processedAmount(q, unit, amount);
+    if (unit == progressUnit) {
+        Q_EMIT q->processedSize(q, amount);
+        q->emitPercent(amount, totalAmount[unit]);
+    }
+}
+
+void VJobPrivate::emitPendingProgress()
+{
+    if (progressTimer)
+        progressTimer->stop();
+
+    // Values held back by the threshold stay pending until an
+    // update passes it, or until flushProgress() on finish
+    bool emitted = false;
+    for (int unit = VJob::Bytes; pendingUnits != 0 && unit <= VJob::Directories; ++unit) {
+        const VJob::Unit u = static_cast<VJob::Unit>(unit);
+        if ((pendingUnits & (1 << unit)) && !isBelowThreshold(u, processedAmount[u])) {
+            emitProcessedAmount(u);
+            emitted = true;
+        }
+    }
+
+    if (emitted && progressInterval > 0)
+        lastProgressTime = elapsed();
+}
+
+void VJobPrivate::flushProgress()
+{
+    if (progressTimer)
+        progressTimer->stop();
+
+    for (int unit = VJob::Bytes; pendingUnits != 0 && unit <= VJob::Directories; ++unit) {
+        if (pendingUnits & (1 << unit))
+            emitProcessedAmount(static_cast<VJob::Unit>(unit));
+    }
+    pendingUnits = 0;
+
+    if (progressInterval > 0)
+        lastProgressTime = elapsed();
+}
+
+void VJobPrivate::sampleSpeed(qulonglong amount)
+{
+    Q_Q(VJob);
+
+    const qint64 now = elapsed();
+
+    // Start over if the amount went back
+    if (!speedSamples.isEmpty() && amount < speedSamples.last().amount)
+        speedSamples.clear();
+
+    // A sample every 250 ms over a 5 seconds window is accurate
+    // enough and keeps the cost per update negligible
+    if (!speedSamples.isEmpty() && now - speedSamples.last().time < 250)
+        return;
+
+    SpeedSample sample;
+    sample.time = now;
+    sample.amount = amount;
+    speedSamples.enqueue(sample);
+    while (speedSamples.size() > 2 && now - speedSamples.head().time > 5000)
+        speedSamples.dequeue();
+
+    if (speedSamples.size() < 2)
+        return;
+
+    const SpeedSample &first = speedSamples.head();
+    if (now > first.time)
+        q->emitSpeed((unsigned long)((amount - first.amount) * 1000 / (now - first.time)));
+}
+
 VJob::VJob(QObject *parent)
     : QObject(parent), d_ptr(new VJobPrivate)
 {
@@ -76,10 +225,12 @@ VJob::VJob(VJobPrivate &dd, QObject *parent)
 VJob::~VJob()
 {
     if (!d_ptr->isFinished) {
+        d_ptr->flushProgress();
         Q_EMIT finished(this);
     }
 
     delete d_ptr->speedTimer;
+    delete d_ptr->progressTimer;
     delete d_ptr->uiDelegate;
     delete d_ptr;
 
@@ -125,6 +276,7 @@ bool VJob::kill(KillVerbosity verbosity)
         } else {
             // If we are displaying a progress dialog, remove it first.
             d->isFinished = true;
+            d->flushProgress();
             Q_EMIT finished(this);
 
             if (isAutoDelete())
@@ -142,6 +294,7 @@ bool VJob::suspend()
     Q_D(VJob);
     if (!d->suspended) {
         if (doSuspend()) {
+            d->flushProgress();
             d->suspended = true;
             Q_EMIT suspended(this);
 
@@ -266,10 +419,15 @@ void VJob::setProcessedAmount(Unit unit, qulonglong amount)
     d->processedAmount[unit] = amount;
 
     if (should_emit) {
-        Q_EMIT processedAmount(this, unit, amount);
-        if (unit == d->progressUnit) {
-            Q_EMIT processedSize(this, amount);
-            emitPercent(d->processedAmount[unit], d->totalAmount[unit]);
+        if (d->speedEstimation && unit == Bytes)
+            d->sampleSpeed(amount);
+
+        if (d->isProgressThrottled(unit, amount)) {
+            d->deferProgress(unit);
+        } else {
+            // Deliver the other units along with this one
+            d->pendingUnits |= (1 << unit);
+            d->emitPendingProgress();
         }
     }
 }
@@ -302,6 +460,7 @@ void VJob::setPercent(unsigned long percentage)
 void VJob::emitResult()
 {
     Q_D(VJob);
+    d->flushProgress();
     d->isFinished = true;
 
     if (d->eventLoop) {
@@ -351,6 +510,11 @@ void VJobPrivate::_q_speedTimeout()
     speedTimer->stop();
 }
 
+void VJobPrivate::_q_progressTimeout()
+{
+    emitPendingProgress();
+}
+
 bool VJob::isAutoDelete() const
 {
     Q_D(const VJob);
@@ -363,4 +527,45 @@ void VJob::setAutoDelete(bool autodelete)
     d->isAutoDelete = autodelete;
 }
 
+int VJob::progressInterval() const
+{
+    Q_D(const VJob);
+    return d->progressInterval;
+}
+
+void VJob::setProgressInterval(int msecs)
+{
+    Q_D(VJob);
+    d->progressInterval = qMax(msecs, 0);
+    if (d->progressInterval == 0)
+        d->emitPendingProgress();
+}
+
+qulonglong VJob::progressThreshold() const
+{
+    Q_D(const VJob);
+    return d->progressThreshold;
+}
+
+void VJob::setProgressThreshold(qulonglong delta)
+{
+    Q_D(VJob);
+    d->progressThreshold = delta;
+    if (d->progressThreshold == 0)
+        d->flushProgress();
+}
+
+bool VJob::isSpeedEstimationEnabled() const
+{
+    Q_D(const VJob);
+    return d->speedEstimation;
+}
+
+void VJob::setSpeedEstimationEnabled(bool enabled)
+{
+    Q_D(VJob);
+    d->speedEstimation = enabled;
+    d->speedSamples.clear();
+}
+
 #include "moc_vjob.cpp"
@@ -359,6 +359,72 @@ public:
      */
     bool isAutoDelete() const;
 
+    /**
+     * Returns the minimum interval between two progress notifications.
+     *
+     * @return the interval in milliseconds, 0 if progress is not
+     * throttled by time
+     * @see setProgressInterval()
+     */
+    int progressInterval() const;
+
+    /**
+     * Sets the minimum interval between two progress notifications.
+     *
+     * When set, setProcessedAmount() emits processedAmount(),
+     * processedSize() and percent() at most once every @p msecs
+     * milliseconds; intermediate values are coalesced and the latest
+     * one is delivered when the interval expires.  The final value,
+     * i.e. when the processed amount reaches the total amount, is always
+     * emitted right away and pending values are flushed before finished()
+     * and suspended().
+     *
+     * The default is 0, which emits a notification for every change.
+     *
+     * @param msecs the interval in milliseconds
+     */
+    void setProgressInterval(int msecs);
+
+    /**
+     * Returns the minimum change of the processed amount needed
+     * to emit a progress notification.
+     *
+     * @return the threshold, 0 if progress is not throttled by amount
+     * @see setProgressThreshold()
+     */
+    qulonglong progressThreshold() const;
+
+    /**
+     * Sets the minimum change of the processed amount, since the last
+     * notification, needed to emit a progress notification.  Can be
+     * combined with setProgressInterval(), in which case both
+     * conditions must be met.  The final value is always emitted.
+     *
+     * The default is 0, which emits a notification for every change.
+     *
+     * @param delta the threshold in units of the processed amount
+     */
+    void setProgressThreshold(qulonglong delta);
+
+    /**
+     * Returns whether the speed is estimated from the processed amount.
+     *
+     * @see setSpeedEstimationEnabled()
+     */
+    bool isSpeedEstimationEnabled() const;
+
+    /**
+     * Enables or disables speed estimation.
+     *
+     * When enabled, the speed() signal is emitted from the amount of
+     * bytes processed over the last few seconds as reported with
+     * setProcessedAmount(), so that subclasses don't need to call
+     * emitSpeed() themselves.  Disabled by default.
+     *
+     * @param enabled whether speed estimation is enabled
+     */
+    void setSpeedEstimationEnabled(bool enabled);
+
 Q_SIGNALS:
 #if !defined(Q_MOC_RUN)
 private: // don't tell moc, but those signals are in fact private
@@ -579,8 +645,8 @@ protected:
 
     /**
      * Sets the processed size. The processedAmount() and percent() signals
-     * are emitted if the values changed. The percent() signal is emitted
-     * only for the progress unit.
+     * are emitted if the values changed, subject to throttling.
+     * The percent() signal is emitted only for the progress unit.
      *
      * @param unit the unit of the new processed amount
      * @param amount the new processed amount
@@ -643,6 +709,7 @@ protected:
 
 private:
     Q_PRIVATE_SLOT(d_func(), void _q_speedTimeout())
+    Q_PRIVATE_SLOT(d_func(), void _q_progressTimeout())
     Q_DECLARE_PRIVATE(VJob)
 };
 
@@ -34,7 +34,9 @@
 #ifndef VJOB_P_H
 #define VJOB_P_H
 
+#include <QElapsedTimer>
 #include <QMap>
+#include <QQueue>
 
 #include "vjob.h"
 
@@ -74,7 +76,32 @@ public:
     bool isAutoDelete;
     QEventLoop *eventLoop;
 
+    struct SpeedSample {
+        qint64 time;
+        qulonglong amount;
+    };
+
+    int progressInterval;
+    qulonglong progressThreshold;
+    bool speedEstimation;
+    QElapsedTimer clock;
+    qint64 lastProgressTime;
+    QMap<VJob::Unit, qulonglong> emittedAmount;
+    int pendingUnits;
+    QTimer *progressTimer;
+    QQueue<SpeedSample> speedSamples;
+
+    qint64 elapsed();
+    bool isBelowThreshold(VJob::Unit unit, qulonglong amount);
+    bool isProgressThrottled(VJob::Unit unit, qulonglong amount);
+    void deferProgress(VJob::Unit unit);
+    void emitProcessedAmount(VJob::Unit unit);
+    void emitPendingProgress();
+    void flushProgress();
+    void sampleSpeed(qulonglong amount);
+
     void _q_speedTimeout();
+    void _q_progressTimeout();
 
     static bool _q_kjobUnitEnumRegistered;
 
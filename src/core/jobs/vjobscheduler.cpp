@@ -0,0 +1,246 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#include <QThread>
+
+#include "vjobscheduler.h"
+#include "vjobscheduler_p.h"
+
+Q_GLOBAL_STATIC(VJobScheduler, s_jobScheduler)
+
+/*
+ * VJobSchedulerPrivate
+ */
+
+VJobSchedulerPrivate::VJobSchedulerPrivate(VJobScheduler *parent)
+    : q_ptr(parent)
+{
+    resources[VJobScheduler::CpuResource].maximum = QThread::idealThreadCount();
+    resources[VJobScheduler::DiskResource].maximum = 2;
+    resources[VJobScheduler::NetworkResource].maximum = 4;
+}
+
+void VJobSchedulerPrivate::takePending(VJob *job, const ScheduledJob &info)
+{
+    ResourceQueue &rq = resources[info.resource];
+
+    QMap<int, QQueue<VJob *> >::iterator it = rq.queues.find(info.priority);
+    if (it == rq.queues.end())
+        return;
+
+    if (it.value().removeOne(job)) {
+        rq.pending--;
+        if (it.value().isEmpty())
+            rq.queues.erase(it);
+    }
+}
+
+void VJobSchedulerPrivate::startJobs(int resource)
+{
+    Q_Q(VJobScheduler);
+
+    for (;;) {
+        // Look the queue up again on every iteration, starting a job
+        // may end up changing the resources hash
+        ResourceQueue &rq = resources[resource];
+        if (rq.pending == 0)
+            break;
+        if (rq.maximum > 0 && rq.running >= rq.maximum)
+            break;
+
+        QMap<int, QQueue<VJob *> >::iterator it = rq.queues.end() - 1;
+        VJob *job = it.value().dequeue();
+        if (it.value().isEmpty())
+            rq.queues.erase(it);
+        rq.pending--;
+        rq.running++;
+
+        jobs[job].running = true;
+
+        Q_EMIT q->jobStarted(job);
+        job->start();
+    }
+}
+
+void VJobSchedulerPrivate::_q_jobFinished(VJob *job)
+{
+    Q_Q(VJobScheduler);
+
+    QHash<VJob *, ScheduledJob>::iterator it = jobs.find(job);
+    if (it == jobs.end())
+        return;
+
+    const ScheduledJob info = it.value();
+    jobs.erase(it);
+    QObject::disconnect(job, 0, q, 0);
+
+    if (info.running) {
+        resources[info.resource].running--;
+        startJobs(info.resource);
+    } else {
+        // Killed or deleted before it had a chance to run
+        takePending(job, info);
+    }
+}
+
+/*
+ * VJobScheduler
+ */
+
+VJobScheduler::VJobScheduler(QObject *parent)
+    : QObject(parent)
+    , d_ptr(new VJobSchedulerPrivate(this))
+{
+}
+
+VJobScheduler::~VJobScheduler()
+{
+    Q_D(VJobScheduler);
+
+    // Running jobs take care of themselves, delete those that
+    // never had a chance to run
+    QList<VJob *> pendingJobs;
+    QHash<VJob *, VJobSchedulerPrivate::ScheduledJob>::const_iterator it;
+    for (it = d->jobs.constBegin(); it != d->jobs.constEnd(); ++it) {
+        QObject::disconnect(it.key(), 0, this, 0);
+        if (!it.value().running)
+            pendingJobs.append(it.key());
+    }
+    d->jobs.clear();
+    qDeleteAll(pendingJobs);
+
+    delete d_ptr;
+}
+
+VJobScheduler *VJobScheduler::instance()
+{
+    return s_jobScheduler();
+}
+
+int VJobScheduler::maximumRunningJobs(int resource) const
+{
+    Q_D(const VJobScheduler);
+    return d->resources.value(resource).maximum;
+}
+
+void VJobScheduler::setMaximumRunningJobs(int resource, int maximum)
+{
+    Q_D(VJobScheduler);
+    d->resources[resource].maximum = qMax(maximum, 0);
+    d->startJobs(resource);
+}
+
+int VJobScheduler::runningJobs(int resource) const
+{
+    Q_D(const VJobScheduler);
+    return d->resources.value(resource).running;
+}
+
+int VJobScheduler::pendingJobs(int resource) const
+{
+    Q_D(const VJobScheduler);
+    return d->resources.value(resource).pending;
+}
+
+bool VJobScheduler::contains(VJob *job) const
+{
+    Q_D(const VJobScheduler);
+    return d->jobs.contains(job);
+}
+
+bool VJobScheduler::isPending(VJob *job) const
+{
+    Q_D(const VJobScheduler);
+
+    QHash<VJob *, VJobSchedulerPrivate::ScheduledJob>::const_iterator it = d->jobs.constFind(job);
+    return it != d->jobs.constEnd() && !it.value().running;
+}
+
+bool VJobScheduler::enqueue(VJob *job, int resource, int priority)
+{
+    Q_D(VJobScheduler);
+
+    if (job == 0 || d->jobs.contains(job))
+        return false;
+
+    VJobSchedulerPrivate::ScheduledJob info;
+    info.resource = resource;
+    info.priority = priority;
+    info.running = false;
+    d->jobs.insert(job, info);
+
+    connect(job, SIGNAL(finished(VJob *)),
+            this, SLOT(_q_jobFinished(VJob *)));
+
+    VJobSchedulerPrivate::ResourceQueue &rq = d->resources[resource];
+    rq.queues[priority].enqueue(job);
+    rq.pending++;
+
+    if (rq.maximum > 0 && rq.running >= rq.maximum)
+        Q_EMIT jobQueued(job);
+    else
+        d->startJobs(resource);
+
+    return true;
+}
+
+bool VJobScheduler::setPriority(VJob *job, int priority)
+{
+    Q_D(VJobScheduler);
+
+    QHash<VJob *, VJobSchedulerPrivate::ScheduledJob>::iterator it = d->jobs.find(job);
+    if (it == d->jobs.end() || it.value().running)
+        return false;
+
+    if (it.value().priority != priority) {
+        d->takePending(job, it.value());
+        it.value().priority = priority;
+
+        VJobSchedulerPrivate::ResourceQueue &rq = d->resources[it.value().resource];
+        rq.queues[priority].enqueue(job);
+        rq.pending++;
+    }
+
+    return true;
+}
+
+bool VJobScheduler::dequeue(VJob *job)
+{
+    Q_D(VJobScheduler);
+
+    QHash<VJob *, VJobSchedulerPrivate::ScheduledJob>::iterator it = d->jobs.find(job);
+    if (it == d->jobs.end() || it.value().running)
+        return false;
+
+    d->takePending(job, it.value());
+    d->jobs.erase(it);
+    QObject::disconnect(job, 0, this, 0);
+
+    return true;
+}
+
+#include "moc_vjobscheduler.cpp"
@@ -0,0 +1,214 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#ifndef VJOBSCHEDULER_H
+#define VJOBSCHEDULER_H
+
+#include <QObject>
+
+#include <VibeCore/VibeCoreExport>
+#include <VibeCore/VJob>
+
+class VJobSchedulerPrivate;
+
+/**
+ * Queues jobs and starts them when a slot for their resource
+ * class becomes available.
+ *
+ * Each job is enqueued with a resource class (disk, CPU, network
+ * or a user defined one) and a priority.  The scheduler never
+ * runs more jobs of a resource class than the concurrency limit
+ * set for that class; the remaining jobs wait in a queue ordered
+ * by priority and, within the same priority, by submission order.
+ *
+ * \code
+ * VJobScheduler *scheduler = VJobScheduler::instance();
+ * scheduler->setMaximumRunningJobs(VJobScheduler::DiskResource, 2);
+ *
+ * foreach (const QString &fileName, fileNames)
+ *     scheduler->enqueue(new ExtractJob(fileName), VJobScheduler::DiskResource);
+ * \endcode
+ *
+ * Jobs are started with VJob::start() and leave the scheduler
+ * when they emit finished(), which also happens when they are
+ * killed or deleted while still waiting in the queue.
+ */
+class VIBECORE_EXPORT VJobScheduler : public QObject
+{
+    Q_OBJECT
+    Q_ENUMS(Resource Priority)
+    Q_DECLARE_PRIVATE(VJobScheduler)
+public:
+    enum Resource {
+        /*** Jobs that do not compete for a specific resource */
+        DefaultResource = 0,
+        /*** CPU bound jobs */
+        CpuResource,
+        /*** Jobs doing disk I/O */
+        DiskResource,
+        /*** Jobs doing network I/O */
+        NetworkResource,
+        /*** Applications should define resource classes starting at this value */
+        UserDefinedResource = 100
+    };
+
+    enum Priority {
+        LowPriority = -10,
+        NormalPriority = 0,
+        HighPriority = 10
+    };
+
+    /**
+     * Creates a new VJobScheduler object.
+     *
+     * @param parent the parent QObject
+     */
+    explicit VJobScheduler(QObject *parent = 0);
+
+    /**
+     * Destroys a VJobScheduler object.
+     * Jobs still waiting in the queue are deleted, running jobs are
+     * left alone.
+     */
+    virtual ~VJobScheduler();
+
+    /**
+     * Returns the scheduler shared by the whole application.
+     */
+    static VJobScheduler *instance();
+
+    /**
+     * Returns the maximum number of jobs of the @p resource class that
+     * are allowed to run at the same time.
+     *
+     * @param resource the resource class
+     * @see setMaximumRunningJobs()
+     */
+    int maximumRunningJobs(int resource) const;
+
+    /**
+     * Sets the maximum number of jobs of the @p resource class that
+     * are allowed to run at the same time.  A value less than or equal
+     * to 0 removes the limit.  Raising the limit starts queued jobs
+     * immediately, lowering it does not affect jobs already running.
+     *
+     * By default CpuResource is limited to QThread::idealThreadCount(),
+     * DiskResource to 2, NetworkResource to 4 and all other classes
+     * are unlimited.
+     *
+     * @param resource the resource class
+     * @param maximum the maximum number of concurrent jobs
+     */
+    void setMaximumRunningJobs(int resource, int maximum);
+
+    /**
+     * Returns the number of jobs of the @p resource class currently running.
+     *
+     * @param resource the resource class
+     */
+    int runningJobs(int resource) const;
+
+    /**
+     * Returns the number of jobs of the @p resource class waiting for
+     * a free slot.
+     *
+     * @param resource the resource class
+     */
+    int pendingJobs(int resource) const;
+
+    /**
+     * Returns whether @p job was enqueued and did not finish yet.
+     *
+     * @param job the job
+     */
+    bool contains(VJob *job) const;
+
+    /**
+     * Returns whether @p job is waiting in the queue.
+     *
+     * @param job the job
+     */
+    bool isPending(VJob *job) const;
+
+    /**
+     * Enqueues a job.
+     *
+     * The job is started right away if its resource class has a free
+     * slot, otherwise it will be started as soon as one of the jobs of
+     * the same class finishes and no other job with higher priority
+     * is waiting.
+     *
+     * @param job the job to schedule
+     * @param resource the resource class the job competes for
+     * @param priority the priority, higher values run first
+     * @return true if the job has been enqueued, false if it's null or
+     *         was already scheduled
+     */
+    bool enqueue(VJob *job, int resource = DefaultResource,
+                 int priority = NormalPriority);
+
+    /**
+     * Changes the priority of a job still waiting in the queue.
+     *
+     * @param job the job
+     * @param priority the new priority
+     * @return true if the job was pending, false otherwise
+     */
+    bool setPriority(VJob *job, int priority);
+
+    /**
+     * Removes a job that is still waiting in the queue without starting it.
+     * The job is not deleted and ownership goes back to the caller.
+     *
+     * @param job the job
+     * @return true if the job was pending, false otherwise
+     */
+    bool dequeue(VJob *job);
+
+Q_SIGNALS:
+    /**
+     * Emitted when a job is put in the queue because its resource
+     * class has no free slots.
+     *
+     * @param job the job
+     */
+    void jobQueued(VJob *job);
+
+    /**
+     * Emitted right before a job is started.
+     *
+     * @param job the job
+     */
+    void jobStarted(VJob *job);
+
+private:
+    Q_PRIVATE_SLOT(d_ptr, void _q_jobFinished(VJob *job))
+
+    VJobSchedulerPrivate *const d_ptr;
+};
+
+#endif // VJOBSCHEDULER_H
@@ -0,0 +1,84 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#ifndef VJOBSCHEDULER_P_H
+#define VJOBSCHEDULER_P_H
+
+#include <QHash>
+#include <QMap>
+#include <QQueue>
+
+#include "vjobscheduler.h"
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Vibe API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+class VJobSchedulerPrivate
+{
+    Q_DECLARE_PUBLIC(VJobScheduler)
+public:
+    struct ScheduledJob {
+        int resource;
+        int priority;
+        bool running;
+    };
+
+    struct ResourceQueue {
+        ResourceQueue() : maximum(0), running(0), pending(0) {}
+
+        int maximum;
+        int running;
+        int pending;
+
+        // Waiting jobs keyed by priority, the highest priority is the
+        // last key and each queue keeps submission order
+        QMap<int, QQueue<VJob *> > queues;
+    };
+
+    VJobSchedulerPrivate(VJobScheduler *parent);
+
+    QHash<VJob *, ScheduledJob> jobs;
+    QHash<int, ResourceQueue> resources;
+
+    void takePending(VJob *job, const ScheduledJob &info);
+    void startJobs(int resource);
+
+    void _q_jobFinished(VJob *job);
+
+protected:
+    VJobScheduler *const q_ptr;
+};
+
+#endif // VJOBSCHEDULER_P_H
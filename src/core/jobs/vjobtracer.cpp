@@ -0,0 +1,350 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <VibeCore/VSaveFile>
+
+#include "vjobtracer.h"
+#include "vjobscheduler.h"
+
+class VJobTracer::Private
+{
+public:
+    struct Record {
+        int id;
+        QString className;
+        qint64 registered;
+        qint64 queued;
+        qint64 started;
+        qint64 finished;
+        qint64 suspendedSince;
+        QList<QPair<qint64, qint64> > suspensions;
+        qulonglong processedBytes;
+        int error;
+        QString errorText;
+    };
+
+    Private(VJobTracer *tracer) : q(tracer), nextId(1), maximumRecords(10000) {
+        clock.start();
+    }
+
+    // Chrome traces use microseconds
+    qint64 now() const {
+        return clock.nsecsElapsed() / 1000;
+    }
+
+    void account(const Record &record);
+    void appendEvents(QJsonArray &events, const Record &record, qint64 end) const;
+
+    VJobTracer *const q;
+    QElapsedTimer clock;
+    int nextId;
+    int maximumRecords;
+    QHash<VJob *, Record> active;
+    QList<Record> records;
+    QHash<QString, ClassStatistics> statistics;
+};
+
+void VJobTracer::Private::account(const Record &record)
+{
+    ClassStatistics &stats = statistics[record.className];
+    stats.className = record.className;
+    stats.jobs++;
+    if (record.error)
+        stats.errors++;
+    if (record.queued >= 0)
+        stats.totalWaitTime += record.started - record.queued;
+
+    qint64 suspendedTime = 0;
+    for (int i = 0; i < record.suspensions.size(); ++i)
+        suspendedTime += record.suspensions.at(i).second - record.suspensions.at(i).first;
+
+    const qint64 runTime = record.finished - record.started - suspendedTime;
+    stats.totalRunTime += runTime;
+    stats.maximumRunTime = qMax(stats.maximumRunTime, runTime);
+    stats.totalSuspendedTime += suspendedTime;
+    stats.processedBytes += record.processedBytes;
+}
+
+void VJobTracer::Private::appendEvents(QJsonArray &events, const Record &record, qint64 end) const
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    if (record.queued >= 0) {
+        QJsonObject event;
+        event.insert(QLatin1String("name"), record.className);
+        event.insert(QLatin1String("cat"), QLatin1String("queue"));
+        event.insert(QLatin1String("ph"), QLatin1String("X"));
+        event.insert(QLatin1String("ts"), double(record.queued));
+        event.insert(QLatin1String("dur"), double((record.started >= 0 ? record.started : end) - record.queued));
+        event.insert(QLatin1String("pid"), double(pid));
+        event.insert(QLatin1String("tid"), record.id);
+        events.append(event);
+    }
+
+    if (record.started >= 0) {
+        QJsonObject args;
+        args.insert(QLatin1String("processedBytes"), double(record.processedBytes));
+        if (record.error) {
+            args.insert(QLatin1String("error"), record.error);
+            args.insert(QLatin1String("errorText"), record.errorText);
+        }
+        if (record.finished < 0)
+            args.insert(QLatin1String("running"), true);
+
+        QJsonObject event;
+        event.insert(QLatin1String("name"), record.className);
+        event.insert(QLatin1String("cat"), QLatin1String("job"));
+        event.insert(QLatin1String("ph"), QLatin1String("X"));
+        event.insert(QLatin1String("ts"), double(record.started));
+        event.insert(QLatin1String("dur"), double(end - record.started));
+        event.insert(QLatin1String("pid"), double(pid));
+        event.insert(QLatin1String("tid"), record.id);
+        event.insert(QLatin1String("args"), args);
+        events.append(event);
+    }
+
+    QList<QPair<qint64, qint64> > suspensions = record.suspensions;
+    if (record.suspendedSince >= 0)
+        suspensions.append(qMakePair(record.suspendedSince, end));
+    for (int i = 0; i < suspensions.size(); ++i) {
+        QJsonObject event;
+        event.insert(QLatin1String("name"), QLatin1String("suspended"));
+        event.insert(QLatin1String("cat"), QLatin1String("suspend"));
+        event.insert(QLatin1String("ph"), QLatin1String("X"));
+        event.insert(QLatin1String("ts"), double(suspensions.at(i).first));
+        event.insert(QLatin1String("dur"), double(suspensions.at(i).second - suspensions.at(i).first));
+        event.insert(QLatin1String("pid"), double(pid));
+        event.insert(QLatin1String("tid"), record.id);
+        events.append(event);
+    }
+}
+
+/*
+ * VJobTracer::ClassStatistics
+ */
+
+VJobTracer::ClassStatistics::ClassStatistics()
+    : jobs(0), errors(0), totalWaitTime(0), totalRunTime(0),
+      maximumRunTime(0), totalSuspendedTime(0), processedBytes(0)
+{
+}
+
+qreal VJobTracer::ClassStatistics::throughput() const
+{
+    if (totalRunTime <= 0)
+        return 0;
+    return qreal(processedBytes) * 1000000 / totalRunTime;
+}
+
+/*
+ * VJobTracer
+ */
+
+VJobTracer::VJobTracer(QObject *parent)
+    : VJobTrackerInterface(parent), d(new Private(this))
+{
+}
+
+VJobTracer::~VJobTracer()
+{
+    delete d;
+}
+
+void VJobTracer::watchScheduler(VJobScheduler *scheduler)
+{
+    connect(scheduler, SIGNAL(jobQueued(VJob *)),
+            this, SLOT(jobQueued(VJob *)));
+    connect(scheduler, SIGNAL(jobStarted(VJob *)),
+            this, SLOT(jobStarted(VJob *)));
+}
+
+int VJobTracer::maximumRecords() const
+{
+    return d->maximumRecords;
+}
+
+void VJobTracer::setMaximumRecords(int maximum)
+{
+    d->maximumRecords = qMax(maximum, 0);
+    while (d->records.size() > d->maximumRecords)
+        d->records.removeFirst();
+}
+
+QList<VJobTracer::ClassStatistics> VJobTracer::statistics() const
+{
+    return d->statistics.values();
+}
+
+QByteArray VJobTracer::toChromeTrace() const
+{
+    const qint64 now = d->now();
+
+    QJsonArray events;
+    foreach (const Private::Record &record, d->records)
+        d->appendEvents(events, record, record.finished);
+    foreach (const Private::Record &record, d->active)
+        d->appendEvents(events, record, now);
+
+    QJsonObject trace;
+    trace.insert(QLatin1String("traceEvents"), events);
+    trace.insert(QLatin1String("displayTimeUnit"), QLatin1String("ms"));
+
+    return QJsonDocument(trace).toJson();
+}
+
+bool VJobTracer::saveChromeTrace(const QString &fileName) const
+{
+    VSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    if (file.write(toChromeTrace()) < 0) {
+        file.abort();
+        return false;
+    }
+
+    return file.finalize();
+}
+
+void VJobTracer::clear()
+{
+    d->records.clear();
+    d->statistics.clear();
+}
+
+void VJobTracer::registerJob(VJob *job)
+{
+    if (d->active.contains(job))
+        return;
+
+    const qint64 now = d->now();
+
+    // Save the class name now, finished() may be called from
+    // the VJob destructor when the subclass is already gone
+    Private::Record record;
+    record.id = d->nextId++;
+    record.className = QString::fromLatin1(job->metaObject()->className());
+    record.registered = now;
+    record.queued = -1;
+    record.started = now;
+    record.finished = -1;
+    record.suspendedSince = -1;
+    record.processedBytes = 0;
+    record.error = VJob::NoError;
+    d->active.insert(job, record);
+
+    VJobTrackerInterface::registerJob(job);
+}
+
+void VJobTracer::unregisterJob(VJob *job)
+{
+    d->active.remove(job);
+    VJobTrackerInterface::unregisterJob(job);
+}
+
+void VJobTracer::finished(VJob *job)
+{
+    QHash<VJob *, Private::Record>::iterator it = d->active.find(job);
+    if (it == d->active.end())
+        return;
+
+    Private::Record record = it.value();
+    d->active.erase(it);
+
+    record.finished = d->now();
+    if (record.started < 0)
+        record.started = record.finished;
+    if (record.suspendedSince >= 0) {
+        record.suspensions.append(qMakePair(record.suspendedSince, record.finished));
+        record.suspendedSince = -1;
+    }
+    record.error = job->error();
+    record.errorText = job->errorText();
+
+    d->account(record);
+
+    if (d->maximumRecords > 0) {
+        d->records.append(record);
+        while (d->records.size() > d->maximumRecords)
+            d->records.removeFirst();
+    }
+}
+
+void VJobTracer::suspended(VJob *job)
+{
+    QHash<VJob *, Private::Record>::iterator it = d->active.find(job);
+    if (it != d->active.end() && it.value().suspendedSince < 0)
+        it.value().suspendedSince = d->now();
+}
+
+void VJobTracer::resumed(VJob *job)
+{
+    QHash<VJob *, Private::Record>::iterator it = d->active.find(job);
+    if (it != d->active.end() && it.value().suspendedSince >= 0) {
+        it.value().suspensions.append(qMakePair(it.value().suspendedSince, d->now()));
+        it.value().suspendedSince = -1;
+    }
+}
+
+void VJobTracer::processedAmount(VJob *job, VJob::Unit unit, qulonglong amount)
+{
+    if (unit != VJob::Bytes)
+        return;
+
+    QHash<VJob *, Private::Record>::iterator it = d->active.find(job);
+    if (it != d->active.end())
+        it.value().processedBytes = amount;
+}
+
+void VJobTracer::jobQueued(VJob *job)
+{
+    registerJob(job);
+
+    QHash<VJob *, Private::Record>::iterator it = d->active.find(job);
+    if (it != d->active.end()) {
+        it.value().queued = d->now();
+        it.value().started = -1;
+    }
+}
+
+void VJobTracer::jobStarted(VJob *job)
+{
+    registerJob(job);
+
+    QHash<VJob *, Private::Record>::iterator it = d->active.find(job);
+    if (it != d->active.end())
+        it.value().started = d->now();
+}
+
+#include "moc_vjobtracer.cpp"
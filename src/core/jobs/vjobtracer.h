@@ -0,0 +1,162 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#ifndef VJOBTRACER_H
+#define VJOBTRACER_H
+
+#include <QList>
+
+#include <VibeCore/VJobTrackerInterface>
+
+class VJobScheduler;
+
+/**
+ * A job tracker that records when jobs run.
+ *
+ * For every registered job the tracer records when it was registered,
+ * queued by a VJobScheduler, started, suspended, resumed and finished,
+ * along with the amount of bytes processed and the error code.
+ * Records are aggregated per job class by statistics() and can be
+ * exported in the Chrome trace-event format, to be loaded in
+ * chrome://tracing or any compatible viewer.
+ *
+ * \code
+ * VJobTracer *tracer = new VJobTracer(this);
+ * tracer->watchScheduler(VJobScheduler::instance());
+ * ...
+ * tracer->saveChromeTrace("/tmp/jobs.json");
+ * \endcode
+ *
+ * Jobs are assumed to start when they are registered, unless they
+ * go through a scheduler that is watched by the tracer.
+ */
+class VIBECORE_EXPORT VJobTracer : public VJobTrackerInterface
+{
+    Q_OBJECT
+public:
+    /**
+     * Statistics about the jobs of the same class.
+     * Times are in microseconds.
+     */
+    struct VIBECORE_EXPORT ClassStatistics {
+        ClassStatistics();
+
+        QString className;
+        int jobs;
+        int errors;
+        qint64 totalWaitTime;
+        qint64 totalRunTime;
+        qint64 maximumRunTime;
+        qint64 totalSuspendedTime;
+        qulonglong processedBytes;
+
+        /**
+         * Returns the average amount of bytes processed
+         * per second of run time.
+         */
+        qreal throughput() const;
+    };
+
+    /**
+     * Creates a new VJobTracer.
+     *
+     * @param parent the parent object
+     */
+    explicit VJobTracer(QObject *parent = 0);
+
+    /**
+     * Destroys a VJobTracer.
+     */
+    virtual ~VJobTracer();
+
+    /**
+     * Registers the jobs enqueued by @p scheduler and records the
+     * time they spend waiting in the queue.
+     *
+     * @param scheduler the scheduler
+     */
+    void watchScheduler(VJobScheduler *scheduler);
+
+    /**
+     * Returns the maximum number of finished jobs kept for the trace.
+     * @see setMaximumRecords()
+     */
+    int maximumRecords() const;
+
+    /**
+     * Sets the maximum number of finished jobs kept for the trace, older
+     * records are discarded first.  Statistics are not affected.
+     * The default is 10000.
+     *
+     * @param maximum the maximum number of records
+     */
+    void setMaximumRecords(int maximum);
+
+    /**
+     * Returns the statistics of the finished jobs, grouped by class.
+     */
+    QList<ClassStatistics> statistics() const;
+
+    /**
+     * Returns the recorded jobs as Chrome trace-event JSON.
+     * Jobs still running are included up to the current time.
+     */
+    QByteArray toChromeTrace() const;
+
+    /**
+     * Saves the output of toChromeTrace() to a file.
+     *
+     * @param fileName the file name
+     * @return true if the file was written successfully, false otherwise
+     */
+    bool saveChromeTrace(const QString &fileName) const;
+
+    /**
+     * Discards all the records and statistics of finished jobs.
+     */
+    void clear();
+
+public Q_SLOTS:
+    virtual void registerJob(VJob *job);
+    virtual void unregisterJob(VJob *job);
+
+protected Q_SLOTS:
+    virtual void finished(VJob *job);
+    virtual void suspended(VJob *job);
+    virtual void resumed(VJob *job);
+    virtual void processedAmount(VJob *job, VJob::Unit unit, qulonglong amount);
+
+private Q_SLOTS:
+    void jobQueued(VJob *job);
+    void jobStarted(VJob *job);
+
+private:
+    class Private;
+    Private *const d;
+};
+
+#endif // VJOBTRACER_H
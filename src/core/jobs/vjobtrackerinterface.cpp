@@ -53,10 +53,12 @@ VJobTrackerInterface::~VJobTrackerInterface()
 
 void VJobTrackerInterface::registerJob(VJob *job)
 {
-    QObject::connect(job, SIGNAL(finished(VJob *)),
-                     this, SLOT(unregisterJob(VJob *)));
+    // finished() must be connected first, slots connected after
+    // unregisterJob() would not be called since it disconnects the job
     QObject::connect(job, SIGNAL(finished(VJob *)),
                      this, SLOT(finished(VJob *)));
+    QObject::connect(job, SIGNAL(finished(VJob *)),
+                     this, SLOT(unregisterJob(VJob *)));
 
     QObject::connect(job, SIGNAL(suspended(VJob *)),
                      this, SLOT(suspended(VJob *)));
@@ -0,0 +1,288 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#include <QEvent>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include "vthreadjob.h"
+#include "vthreadjob_p.h"
+
+class VThreadJobRunnable : public QRunnable
+{
+public:
+    VThreadJobRunnable(VThreadJobPrivate *job)
+        : m_job(job) {
+    }
+
+    void run() {
+        m_job->work();
+    }
+
+private:
+    VThreadJobPrivate *m_job;
+};
+
+/*
+ * VThreadJobPrivate
+ */
+
+VThreadJobPrivate::VThreadJobPrivate()
+    : pool(0), running(false), deleteWhenDone(false),
+      cancelled(0), suspendRequested(false), workerActive(false),
+      progressPosted(false)
+{
+}
+
+VThreadJobPrivate::~VThreadJobPrivate()
+{
+}
+
+void VThreadJobPrivate::work()
+{
+    Q_Q(VThreadJob);
+
+    if (!cancelled.load())
+        q->run();
+
+    // Post the notification before clearing workerActive: as soon as
+    // the mutex is released waitForFinished() may return
+    QMutexLocker locker(&mutex);
+    QMetaObject::invokeMethod(q, "_q_workFinished", Qt::QueuedConnection);
+    workerActive = false;
+    condition.wakeAll();
+}
+
+void VThreadJobPrivate::postProgress()
+{
+    Q_Q(VThreadJob);
+
+    // Must be called with the mutex locked; only one delivery is
+    // queued at a time no matter how often run() reports progress
+    if (!progressPosted) {
+        progressPosted = true;
+        QMetaObject::invokeMethod(q, "_q_deliverProgress", Qt::QueuedConnection);
+    }
+}
+
+void VThreadJobPrivate::_q_workFinished()
+{
+    Q_Q(VThreadJob);
+
+    running = false;
+
+    // Make sure the last reported values are delivered before the result
+    _q_deliverProgress();
+
+    if (deleteWhenDone) {
+        q->deleteLater();
+        return;
+    }
+
+    // Killed while run() was executing
+    if (isFinished)
+        return;
+
+    q->emitResult();
+}
+
+void VThreadJobPrivate::_q_deliverProgress()
+{
+    Q_Q(VThreadJob);
+
+    QMap<VJob::Unit, qulonglong> processed;
+    QMap<VJob::Unit, qulonglong> total;
+
+    mutex.lock();
+    processed.swap(pendingProcessedAmount);
+    total.swap(pendingTotalAmount);
+    progressPosted = false;
+    mutex.unlock();
+
+    QMap<VJob::Unit, qulonglong>::const_iterator it;
+    for (it = total.constBegin(); it != total.constEnd(); ++it)
+        q->setTotalAmount(it.key(), it.value());
+    for (it = processed.constBegin(); it != processed.constEnd(); ++it)
+        q->setProcessedAmount(it.key(), it.value());
+}
+
+void VThreadJobPrivate::_q_deliverInfoMessage(const QString &plain, const QString &rich)
+{
+    Q_Q(VThreadJob);
+    Q_EMIT q->infoMessage(q, plain, rich);
+}
+
+/*
+ * VThreadJob
+ */
+
+VThreadJob::VThreadJob(QObject *parent)
+    : VJob(*new VThreadJobPrivate, parent)
+{
+    setCapabilities(Killable | Suspendable);
+}
+
+VThreadJob::VThreadJob(VThreadJobPrivate &dd, QObject *parent)
+    : VJob(dd, parent)
+{
+    setCapabilities(Killable | Suspendable);
+}
+
+VThreadJob::~VThreadJob()
+{
+    Q_D(VThreadJob);
+
+    // Waiting here would be too late, run() may already be using
+    // members of the subclass that have been destroyed
+    QMutexLocker locker(&d->mutex);
+    if (d->workerActive)
+        qCritical("VThreadJob: deleted while run() is executing, "
+                  "call waitForFinished() from the subclass destructor");
+    Q_ASSERT_X(!d->workerActive, "VThreadJob::~VThreadJob", "run() is still executing");
+}
+
+QThreadPool *VThreadJob::threadPool() const
+{
+    Q_D(const VThreadJob);
+    return d->pool ? d->pool : QThreadPool::globalInstance();
+}
+
+void VThreadJob::setThreadPool(QThreadPool *pool)
+{
+    Q_D(VThreadJob);
+    d->pool = pool;
+}
+
+void VThreadJob::start()
+{
+    Q_D(VThreadJob);
+
+    if (d->running)
+        return;
+
+    d->running = true;
+    d->mutex.lock();
+    d->workerActive = true;
+    d->mutex.unlock();
+
+    threadPool()->start(new VThreadJobRunnable(d));
+}
+
+void VThreadJob::waitForFinished()
+{
+    Q_D(VThreadJob);
+
+    QMutexLocker locker(&d->mutex);
+    while (d->workerActive)
+        d->condition.wait(&d->mutex);
+}
+
+bool VThreadJob::isCancelled() const
+{
+    Q_D(const VThreadJob);
+    return d->cancelled.load() != 0;
+}
+
+bool VThreadJob::checkpoint()
+{
+    Q_D(VThreadJob);
+
+    QMutexLocker locker(&d->mutex);
+    while (d->suspendRequested && !d->cancelled.load())
+        d->condition.wait(&d->mutex);
+    return !d->cancelled.load();
+}
+
+void VThreadJob::reportProcessedAmount(Unit unit, qulonglong amount)
+{
+    Q_D(VThreadJob);
+
+    QMutexLocker locker(&d->mutex);
+    d->pendingProcessedAmount[unit] = amount;
+    d->postProgress();
+}
+
+void VThreadJob::reportTotalAmount(Unit unit, qulonglong amount)
+{
+    Q_D(VThreadJob);
+
+    QMutexLocker locker(&d->mutex);
+    d->pendingTotalAmount[unit] = amount;
+    d->postProgress();
+}
+
+void VThreadJob::reportInfoMessage(const QString &plain, const QString &rich)
+{
+    QMetaObject::invokeMethod(this, "_q_deliverInfoMessage", Qt::QueuedConnection,
+                              Q_ARG(QString, plain), Q_ARG(QString, rich));
+}
+
+bool VThreadJob::doKill()
+{
+    Q_D(VThreadJob);
+
+    d->cancelled.store(1);
+
+    QMutexLocker locker(&d->mutex);
+    d->condition.wakeAll();
+    return true;
+}
+
+bool VThreadJob::doSuspend()
+{
+    Q_D(VThreadJob);
+
+    QMutexLocker locker(&d->mutex);
+    d->suspendRequested = true;
+    return true;
+}
+
+bool VThreadJob::doResume()
+{
+    Q_D(VThreadJob);
+
+    QMutexLocker locker(&d->mutex);
+    d->suspendRequested = false;
+    d->condition.wakeAll();
+    return true;
+}
+
+bool VThreadJob::event(QEvent *event)
+{
+    Q_D(VThreadJob);
+
+    // Deleting the job would pull the rug from under run(), postpone
+    // the deletion until the worker is done
+    if (event->type() == QEvent::DeferredDelete && d->running) {
+        d->deleteWhenDone = true;
+        return true;
+    }
+
+    return VJob::event(event);
+}
+
+#include "moc_vthreadjob.cpp"
@@ -0,0 +1,188 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#ifndef VTHREADJOB_H
+#define VTHREADJOB_H
+
+#include <VibeCore/VibeCoreExport>
+#include <VibeCore/VJob>
+
+class QThreadPool;
+class VThreadJobPrivate;
+
+/**
+ * A job that does its work on a thread pool.
+ *
+ * Subclasses reimplement run(), which is executed on a thread of the
+ * pool set with setThreadPool() (QThreadPool::globalInstance() by
+ * default), while the job object itself, its signals and its result
+ * stay on the thread that owns it.
+ *
+ * \code
+ * void HashJob::run()
+ * {
+ *     while (!m_file.atEnd()) {
+ *         if (!checkpoint())
+ *             return;
+ *
+ *         m_hash.addData(m_file.read(65536));
+ *         reportProcessedAmount(VJob::Bytes, m_file.pos());
+ *     }
+ * }
+ * \endcode
+ *
+ * Killing and suspending are cooperative: run() should call checkpoint()
+ * regularly, which blocks while the job is suspended and returns false
+ * once the job has been killed.
+ *
+ * The result() signal is emitted on the owner thread after run() returned,
+ * unless the job was killed in the meantime.  run() can call setError()
+ * and setErrorText(), the values are read only after it returned.
+ *
+ * deleteLater(), and thus the automatic deletion done by kill() and
+ * emitResult(), is postponed until run() returns.  A job must not be
+ * destroyed in any other way while run() is executing: subclasses that
+ * can be deleted directly must wait for run() in their own destructor,
+ * before the members it uses are gone.
+ *
+ * \code
+ * HashJob::~HashJob()
+ * {
+ *     waitForFinished();
+ * }
+ * \endcode
+ */
+class VIBECORE_EXPORT VThreadJob : public VJob
+{
+    Q_OBJECT
+public:
+    /**
+     * Creates a new VThreadJob object.
+     *
+     * @param parent the parent QObject
+     */
+    explicit VThreadJob(QObject *parent = 0);
+
+    /**
+     * Destroys a VThreadJob object.
+     */
+    virtual ~VThreadJob();
+
+    /**
+     * Returns the thread pool run() is executed on.
+     */
+    QThreadPool *threadPool() const;
+
+    /**
+     * Sets the thread pool run() will be executed on.
+     * Must be called before start().
+     *
+     * @param pool the thread pool, if null the global thread pool is used
+     */
+    void setThreadPool(QThreadPool *pool);
+
+    /**
+     * Queues run() on the thread pool.
+     */
+    virtual void start();
+
+    /**
+     * Blocks until run() has returned, returns immediately if it
+     * is not executing.  This does not stop run(), kill the job
+     * first to have it return early; a suspended job must be
+     * killed or resumed, otherwise this never returns.
+     */
+    void waitForFinished();
+
+    /**
+     * Returns whether the job has been killed.
+     * This method is thread-safe.
+     */
+    bool isCancelled() const;
+
+protected:
+    /**
+     * Does the actual work, this is executed on a thread of the pool.
+     * Subclasses must not touch objects living on the owner thread
+     * from here, use the report methods instead.
+     */
+    virtual void run() = 0;
+
+    /**
+     * Cancellation and suspension point, to be called by run().
+     * Blocks while the job is suspended.
+     *
+     * @return false if the job has been killed and run() should return
+     *         as soon as possible, true otherwise
+     */
+    bool checkpoint();
+
+    /**
+     * Sets the processed amount from run().
+     * Updates are coalesced and delivered to the owner thread with
+     * setProcessedAmount(), the last value is always delivered.
+     *
+     * @param unit the unit of the new processed amount
+     * @param amount the new processed amount
+     */
+    void reportProcessedAmount(Unit unit, qulonglong amount);
+
+    /**
+     * Sets the total amount from run().
+     * Updates are coalesced and delivered to the owner thread with
+     * setTotalAmount(), the last value is always delivered.
+     *
+     * @param unit the unit of the new total amount
+     * @param amount the new total amount
+     */
+    void reportTotalAmount(Unit unit, qulonglong amount);
+
+    /**
+     * Emits infoMessage() on the owner thread, to be called by run().
+     *
+     * @param plain the info message
+     * @param rich the rich text version of the message
+     */
+    void reportInfoMessage(const QString &plain, const QString &rich = QString());
+
+    virtual bool doKill();
+    virtual bool doSuspend();
+    virtual bool doResume();
+
+    virtual bool event(QEvent *event);
+
+protected:
+    VThreadJob(VThreadJobPrivate &dd, QObject *parent);
+
+private:
+    Q_PRIVATE_SLOT(d_func(), void _q_workFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_deliverProgress())
+    Q_PRIVATE_SLOT(d_func(), void _q_deliverInfoMessage(const QString &, const QString &))
+    Q_DECLARE_PRIVATE(VThreadJob)
+};
+
+#endif // VTHREADJOB_H
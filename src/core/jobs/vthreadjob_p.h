@@ -0,0 +1,82 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#ifndef VTHREADJOB_P_H
+#define VTHREADJOB_P_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "vthreadjob.h"
+#include "vjob_p.h"
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Vibe API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+class VIBECORE_EXPORT VThreadJobPrivate : public VJobPrivate
+{
+public:
+    VThreadJobPrivate();
+    ~VThreadJobPrivate();
+
+    QThreadPool *pool;
+
+    // Owner thread only
+    bool running;
+    bool deleteWhenDone;
+
+    QAtomicInt cancelled;
+
+    // Protected by mutex
+    QMutex mutex;
+    QWaitCondition condition;
+    bool suspendRequested;
+    bool workerActive;
+    bool progressPosted;
+    QMap<VJob::Unit, qulonglong> pendingProcessedAmount;
+    QMap<VJob::Unit, qulonglong> pendingTotalAmount;
+
+    void work();
+    void postProgress();
+
+    void _q_workFinished();
+    void _q_deliverProgress();
+    void _q_deliverInfoMessage(const QString &plain, const QString &rich);
+
+    Q_DECLARE_PUBLIC(VThreadJob)
+};
+
+#endif // VTHREADJOB_P_H
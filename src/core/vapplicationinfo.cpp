@@ -26,9 +26,25 @@
  ***************************************************************************/
 
 #include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
 #include <QUrl>
+#include <QVarLengthArray>
 #include <QVariant>
 #include <QProcess>
+#include <QStandardPaths>
+
+#ifdef Q_OS_UNIX
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <spawn.h>
+#  include <string.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+
+extern char **environ;
+#endif
 
 #include "vapplicationinfo.h"
 #include "vapplicationinfo_p.h"
@@ -39,16 +55,13 @@
  */
 
 VApplicationInfoPrivate::VApplicationInfoPrivate(VApplicationInfo *q, const QString &fileName) :
+    execTemplateParsed(false),
     q_ptr(q)
 {
     desktopFile = new VDesktopFile(fileName);
-    isValid = desktopFile->isValid();
 
     // Cache information
-    name = desktopFile->name();
-    genericName = desktopFile->genericName();
-    comment = desktopFile->comment();
-    iconName = desktopFile->iconName();
+    snapshot = takeSnapshot();
 }
 
 VApplicationInfoPrivate::~VApplicationInfoPrivate()
@@ -56,15 +69,73 @@ VApplicationInfoPrivate::~VApplicationInfoPrivate()
     delete desktopFile;
 }
 
+QStringList VApplicationInfoPrivate::parseExec(const QString &exec)
+{
+    /*
+     * The specification says:
+     *
+     * Arguments are separated by a space. Arguments may be quoted. If an
+     * argument contains a reserved character the argument must be quoted.
+     * Quoting must be done by enclosing the argument between double quotes
+     * and escaping the double quote character, backtick character ("`"),
+     * dollar sign ("$") and backslash character ("\") by preceding it with
+     * an additional backslash character.
+     */
+    QStringList result;
+    QString arg;
+    bool hasArg = false;
+    bool quoted = false;
+
+    const QChar *c = exec.constData();
+    const QChar *end = c + exec.size();
+    for (; c < end; ++c) {
+        if (quoted) {
+            if (*c == QLatin1Char('\\') && c + 1 < end &&
+                    (c[1] == QLatin1Char('"') || c[1] == QLatin1Char('`') ||
+                     c[1] == QLatin1Char('$') || c[1] == QLatin1Char('\\')))
+                arg.append(*(++c));
+            else if (*c == QLatin1Char('"'))
+                quoted = false;
+            else
+                arg.append(*c);
+        } else if (*c == QLatin1Char('"')) {
+            quoted = true;
+            hasArg = true;
+        } else if (*c == QLatin1Char(' ') || *c == QLatin1Char('\t')) {
+            if (hasArg) {
+                result.append(arg);
+                arg.clear();
+                hasArg = false;
+            }
+        } else {
+            arg.append(*c);
+            hasArg = true;
+        }
+    }
+
+    if (hasArg)
+        result.append(arg);
+
+    return result;
+}
+
 QStringList VApplicationInfoPrivate::extractExecArgs(const QStringList &args)
 {
+    // Parsing is done once, only field codes are expanded each time
+    if (!execTemplateParsed) {
+        execTemplate = parseExec(desktopFile->executeCommand());
+        execTemplateParsed = true;
+    }
+
     QStringList result;
-    // TODO: Need to handle quoting see http://standards.freedesktop.org/desktop-entry-spec/latest/ar01s06.html
-    QStringList tokens = desktopFile->executeCommand().split(QLatin1Char(' '));
+    if (execTemplate.isEmpty())
+        return result;
 
-    result << tokens.at(0);
+    result << execTemplate.at(0);
+
+    for (int i = 1; i < execTemplate.size(); ++i) {
+        const QString &token = execTemplate.at(i);
 
-    foreach(QString token, tokens) {
         /*
          * The specification says:
          *
@@ -90,7 +161,8 @@ QStringList VApplicationInfoPrivate::extractExecArgs(const QStringList &args)
          * A list of files. Use for apps that can open several local files at once. Each file is passed as a separate argument to the executable program.
          */
         if (token == QLatin1String("%F")) {
-            result << expandEnvVariables(args.join(QLatin1Char(' ')));
+            foreach(const QString &f, args)
+                result << expandEnvVariables(f);
             continue;
         }
 
@@ -100,10 +172,8 @@ QStringList VApplicationInfoPrivate::extractExecArgs(const QStringList &args)
          * A single URL. Local files may either be passed as file: URLs or as file path.
          */
         if (token == QLatin1String("%u")) {
-            if (!args.isEmpty()) {
-                QUrl url(expandEnvVariables(args.at(0)));
-                result << (!url.toLocalFile().isEmpty() ? url.toLocalFile() : url.toEncoded());
-            }
+            if (!args.isEmpty())
+                result << localFileOrUrl(args.at(0));
             continue;
         }
 
@@ -114,10 +184,8 @@ QStringList VApplicationInfoPrivate::extractExecArgs(const QStringList &args)
          * executable program. Local files may either be passed as file: URLs or as file path.
          */
         if (token == QLatin1String("%U")) {
-            foreach(QString u, args) {
-                QUrl url(expandEnvVariables(u));
-                result << (!url.toLocalFile().isEmpty() ? url.toLocalFile() : url.toEncoded());
-            }
+            foreach(const QString &u, args)
+                result << localFileOrUrl(u);
             continue;
         }
 
@@ -129,9 +197,8 @@ QStringList VApplicationInfoPrivate::extractExecArgs(const QStringList &args)
          * to any arguments if the Icon key is empty or missing.
          */
         if (token == QLatin1String("%i")) {
-            QString icon = desktopFile->iconName();
-            if (!icon.isEmpty())
-                result << QLatin1String("-icon") << icon.replace(QLatin1Char('%'), QLatin1String("%%"));
+            if (!snapshot.iconName.isEmpty())
+                result << QLatin1String("--icon") << snapshot.iconName;
             continue;
         }
 
@@ -142,7 +209,7 @@ QStringList VApplicationInfoPrivate::extractExecArgs(const QStringList &args)
          * Name key in the desktop entry.
          */
         if (token == QLatin1String("%c")) {
-            result << desktopFile->name().replace(QLatin1Char('%'), QLatin1String("%%"));
+            result << snapshot.name;
             continue;
         }
 
@@ -153,8 +220,21 @@ QStringList VApplicationInfoPrivate::extractExecArgs(const QStringList &args)
          * gotten from the vfolder system) or a local filename or empty if no
          * location is known.
          */
-        if (token == QLatin1String("%k"))
-            result << desktopFile->fileName().replace(QLatin1Char('%'), QLatin1String("%%"));
+        if (token == QLatin1String("%k")) {
+            result << desktopFile->fileName();
+            continue;
+        }
+
+        // Deprecated field codes are removed
+        if (token.size() == 2 && token.at(0) == QLatin1Char('%') &&
+                QString("dDnNvm").contains(token.at(1)))
+            continue;
+
+        // A literal argument
+        if (token.contains(QLatin1String("%%")))
+            result << QString(token).replace(QLatin1String("%%"), QLatin1String("%"));
+        else
+            result << token;
     }
 
     return result;
@@ -162,6 +242,9 @@ QStringList VApplicationInfoPrivate::extractExecArgs(const QStringList &args)
 
 bool VApplicationInfoPrivate::launch(const QStringList &_args)
 {
+    QElapsedTimer timer;
+    timer.start();
+
     QStringList args = extractExecArgs(_args);
     if (args.isEmpty())
         return false;
@@ -179,42 +262,174 @@ bool VApplicationInfoPrivate::launch(const QStringList &_args)
 
     QString cmd = args.takeFirst();
     QString wd = desktopFile->workingDirectory().absolutePath();
-    return QProcess::startDetached(cmd, args, wd);
+
+    // Paths, relative ones included, are resolved by the shell in the
+    // working directory; looking into PATH costs a few stat() calls, so
+    // remember where the program was found as long as it is still there
+    if (!cmd.contains(QLatin1Char('/'))) {
+        const QByteArray searchPath = qgetenv("PATH");
+        if (cmd != programName || searchPath != programSearchPath ||
+                !QFileInfo(programPath).isExecutable()) {
+            const QString path = QStandardPaths::findExecutable(cmd);
+            if (path.isEmpty()) {
+                qWarning("Unable to launch %s: not found", qPrintable(cmd));
+                return false;
+            }
+            programName = cmd;
+            programPath = path;
+            programSearchPath = searchPath;
+        }
+        cmd = programPath;
+    }
+
+    qint64 pid = 0;
+    if (!spawnDetached(cmd, args, wd, &pid))
+        return false;
+
+    Q_EMIT q_ptr->launched(pid, timer.nsecsElapsed() / 1000);
+    return true;
 }
 
-void VApplicationInfoPrivate::_q_desktopFileChanged()
+bool VApplicationInfoPrivate::spawnDetached(const QString &program, const QStringList &args,
+                                            const QString &workingDirectory, qint64 *pid)
 {
-    // Desktop file has changed, let's what fields were exactly changed
-    if (isValid != desktopFile->isValid()) {
-        isValid = desktopFile->isValid();
-        emit q_ptr->validChanged(isValid);
+#ifdef Q_OS_UNIX
+    /*
+     * QProcess::startDetached() forks the whole process, page tables
+     * included, which is slow for a large GUI process.  Instead we
+     * posix_spawn() a shell that changes directory and starts the
+     * program in the background: it exits right away leaving the
+     * program to init, just like a double fork would.
+     */
+    static const char script[] = "cd \"$0\" 2>/dev/null; \"$@\" </dev/null 3>&- & echo $! >&3";
+
+    QList<QByteArray> encoded;
+    encoded << QByteArrayLiteral("/bin/sh") << QByteArrayLiteral("-c") << QByteArray(script)
+            << QFile::encodeName(workingDirectory) << QFile::encodeName(program);
+    foreach (const QString &arg, args)
+        encoded << arg.toLocal8Bit();
+
+    QVarLengthArray<char *, 32> argv;
+    for (int i = 0; i < encoded.size(); ++i)
+        argv.append(encoded[i].data());
+    argv.append(0);
+
+    /*
+     * The shell tells us the pid of the program through a pipe.  Only
+     * fd 3 of the shell may refer to its write end, which the script
+     * closes for the program: any other copy inherited by the program
+     * would keep us from seeing the end of the pid.
+     */
+    int fds[2];
+#ifdef Q_OS_LINUX
+    if (pipe2(fds, O_CLOEXEC) != 0)
+        return false;
+#else
+    if (pipe(fds) != 0)
+        return false;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    if (fds[1] != 3) {
+        posix_spawn_file_actions_adddup2(&actions, fds[1], 3);
+        posix_spawn_file_actions_addclose(&actions, fds[1]);
+    } else {
+        // dup2() onto itself would leave close-on-exec set
+        fcntl(fds[1], F_SETFD, 0);
     }
-    if (isValid) {
-        if (identifier != desktopFile->value("X-Hawaii-Identifier").toString()) {
-            identifier = desktopFile->value("X-Hawaii-Identifier").toString();
-            emit q_ptr->identifierChanged(identifier);
-        }
-        if (version != desktopFile->value("X-Hawaii-Version").toString()) {
-            version = desktopFile->value("X-Hawaii-Version").toString();
-            emit q_ptr->versionChanged(version);
-        }
-        if (name != desktopFile->name()) {
-            name = desktopFile->name();
-            emit q_ptr->nameChanged(name);
-        }
-        if (genericName != desktopFile->genericName()) {
-            genericName = desktopFile->genericName();
-            emit q_ptr->genericNameChanged(name);
-        }
-        if (comment != desktopFile->comment()) {
-            comment = desktopFile->comment();
-            emit q_ptr->commentChanged(comment);
-        }
-        if (iconName != desktopFile->iconName()) {
-            iconName = desktopFile->iconName();
-            emit q_ptr->iconNameChanged(iconName);
+
+    pid_t shell;
+    int result = posix_spawn(&shell, argv[0], &actions, 0, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(fds[1]);
+
+    if (result != 0) {
+        ::close(fds[0]);
+        qWarning("Unable to launch %s: %s", qPrintable(program), strerror(result));
+        return false;
+    }
+
+    // The pid is a single line, don't wait for the end of the pipe
+    char buffer[32];
+    qint64 size = 0;
+    ssize_t n;
+    while (size < qint64(sizeof(buffer)) - 1 &&
+           (n = ::read(fds[0], buffer + size, sizeof(buffer) - 1 - size)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
         }
+        const bool complete = memchr(buffer + size, '\n', n) != 0;
+        size += n;
+        if (complete)
+            break;
     }
+    buffer[size] = '\0';
+    ::close(fds[0]);
+
+    // The shell is done once it wrote the pid
+    int status;
+    while (waitpid(shell, &status, 0) < 0 && errno == EINTR)
+        ;
+
+    const qint64 programPid = QByteArray(buffer).trimmed().toLongLong();
+    if (pid)
+        *pid = programPid;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 && programPid > 0;
+#else
+    return QProcess::startDetached(program, args, workingDirectory, pid);
+#endif
+}
+
+VApplicationInfoPrivate::Snapshot VApplicationInfoPrivate::takeSnapshot() const
+{
+    Snapshot result;
+    result.isValid = desktopFile->isValid() &&
+                     desktopFile->type() == VDesktopFile::ApplicationType;
+    if (result.isValid) {
+        result.identifier = desktopFile->value("X-Hawaii-Identifier").toString();
+        result.version = desktopFile->value("X-Hawaii-Version").toString();
+        result.name = desktopFile->name();
+        result.genericName = desktopFile->genericName();
+        result.comment = desktopFile->comment();
+        result.iconName = desktopFile->iconName();
+    }
+    return result;
+}
+
+void VApplicationInfoPrivate::_q_desktopFileChanged()
+{
+    // Desktop file has changed, let's see what fields were exactly changed;
+    // VDesktopFile already skips changes that leave the entry as it was
+    const Snapshot previous = snapshot;
+    snapshot = takeSnapshot();
+    execTemplateParsed = false;
+
+    if (previous.isValid != snapshot.isValid)
+        emit q_ptr->validChanged(snapshot.isValid);
+    if (previous.identifier != snapshot.identifier)
+        emit q_ptr->identifierChanged(snapshot.identifier);
+    if (previous.version != snapshot.version)
+        emit q_ptr->versionChanged(snapshot.version);
+    if (previous.name != snapshot.name)
+        emit q_ptr->nameChanged(snapshot.name);
+    if (previous.genericName != snapshot.genericName)
+        emit q_ptr->genericNameChanged(snapshot.genericName);
+    if (previous.comment != snapshot.comment)
+        emit q_ptr->commentChanged(snapshot.comment);
+    if (previous.iconName != snapshot.iconName)
+        emit q_ptr->iconNameChanged(snapshot.iconName);
+}
+
+QString VApplicationInfoPrivate::localFileOrUrl(const QString &str)
+{
+    QUrl url(expandEnvVariables(str));
+    return !url.toLocalFile().isEmpty() ? url.toLocalFile() : QString::fromUtf8(url.toEncoded());
 }
 
 void VApplicationInfoPrivate::expandEnvVariable(QString &str, const QString &varName, const QString &after)
@@ -282,8 +497,7 @@ QString VApplicationInfo::fileName() const
 bool VApplicationInfo::isValid() const
 {
     Q_D(const VApplicationInfo);
-    return d->desktopFile->isValid() &&
-           d->desktopFile->type() == VDesktopFile::ApplicationType;
+    return d->snapshot.isValid;
 }
 
 /*!
@@ -293,7 +507,7 @@ bool VApplicationInfo::isValid() const
 QString VApplicationInfo::identifier() const
 {
     Q_D(const VApplicationInfo);
-    return d->desktopFile->value("X-Hawaii-Identifier").toString();
+    return d->snapshot.identifier;
 }
 
 /*!
@@ -303,7 +517,7 @@ QString VApplicationInfo::identifier() const
 QString VApplicationInfo::version() const
 {
     Q_D(const VApplicationInfo);
-    return d->desktopFile->value("X-Hawaii-Version").toString();
+    return d->snapshot.version;
 }
 
 /*!
@@ -312,7 +526,7 @@ QString VApplicationInfo::version() const
 QString VApplicationInfo::name() const
 {
     Q_D(const VApplicationInfo);
-    return d->desktopFile->name();
+    return d->snapshot.name;
 }
 
 /*!
@@ -321,7 +535,7 @@ QString VApplicationInfo::name() const
 QString VApplicationInfo::genericName() const
 {
     Q_D(const VApplicationInfo);
-    return d->desktopFile->genericName();
+    return d->snapshot.genericName;
 }
 
 /*!
@@ -330,7 +544,7 @@ QString VApplicationInfo::genericName() const
 QString VApplicationInfo::comment() const
 {
     Q_D(const VApplicationInfo);
-    return d->desktopFile->comment();
+    return d->snapshot.comment;
 }
 
 /*!
@@ -343,7 +557,7 @@ QString VApplicationInfo::comment() const
 QString VApplicationInfo::iconName() const
 {
     Q_D(const VApplicationInfo);
-    return d->desktopFile->iconName();
+    return d->snapshot.iconName;
 }
 
 /*!
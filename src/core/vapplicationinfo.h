@@ -95,6 +95,13 @@ signals:
     void commentChanged(const QString &comment);
     void iconNameChanged(const QString &iconName);
 
+    /**
+     * Emitted when the application was started by launch().
+     * \param pid process identifier of the application.
+     * \param elapsed microseconds spent in launch().
+     */
+    void launched(qint64 pid, qint64 elapsed);
+
 private:
     Q_DECLARE_PRIVATE(VApplicationInfo)
     Q_PRIVATE_SLOT(d_ptr, void _q_desktopFileChanged())
@@ -47,19 +47,39 @@ public:
     explicit VApplicationInfoPrivate(VApplicationInfo *q, const QString &fileName);
     ~VApplicationInfoPrivate();
 
+    static QStringList parseExec(const QString &exec);
     QStringList extractExecArgs(const QStringList &args);
 
     bool launch(const QStringList &_args);
+    bool spawnDetached(const QString &program, const QStringList &args,
+                       const QString &workingDirectory, qint64 *pid);
+
+    // Properties with a notify signal, all read in one go
+    struct Snapshot {
+        Snapshot() : isValid(false) {}
+
+        bool isValid;
+        QString identifier;
+        QString version;
+        QString name;
+        QString genericName;
+        QString comment;
+        QString iconName;
+    };
+
+    Snapshot takeSnapshot() const;
 
     VDesktopFile *desktopFile;
-    bool isValid;
+    Snapshot snapshot;
+
+    // Exec split into arguments, parsed on first launch
+    QStringList execTemplate;
+    bool execTemplateParsed;
 
-    QString identifier;
-    QString version;
-    QString name;
-    QString genericName;
-    QString comment;
-    QString iconName;
+    // Last program successfully looked up in PATH, and the PATH it was found in
+    QString programName;
+    QString programPath;
+    QByteArray programSearchPath;
 
 public slots:
     void _q_desktopFileChanged();
@@ -71,6 +91,7 @@ protected:
 private:
     void expandEnvVariable(QString &str, const QString &varName, const QString &after);
     QString expandEnvVariables(const QString &str);
+    QString localFileOrUrl(const QString &str);
 };
 
 #endif // VAPPLICATIONINFO_P_H
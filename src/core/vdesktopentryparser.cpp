@@ -0,0 +1,342 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#include <string.h>
+
+#include <QByteArray>
+#include <QFile>
+#include <QLocale>
+#include <QMutex>
+#include <QVarLengthArray>
+
+#include "vdesktopentryparser_p.h"
+
+/*
+ * Utility functions.
+ */
+
+namespace
+{
+    // Keys are the same few strings in every file, share them
+    struct KeyTable {
+        QMutex mutex;
+        QHash<QByteArray, QString> keys;
+    };
+
+    struct LocaleNames {
+        LocaleNames() {
+            QByteArray locale = qgetenv("LC_ALL");
+            if (locale.isEmpty())
+                locale = qgetenv("LC_MESSAGES");
+            if (locale.isEmpty())
+                locale = qgetenv("LANG");
+
+            QString name = locale.isEmpty() ? QLocale::system().name() : QString::fromLatin1(locale);
+            if (name == QLatin1String("C") || name == QLatin1String("POSIX"))
+                return;
+
+            // lang_COUNTRY.ENCODING@MODIFIER
+            QString modifier;
+            int pos = name.indexOf(QLatin1Char('@'));
+            if (pos >= 0) {
+                modifier = name.mid(pos + 1);
+                name.truncate(pos);
+            }
+            pos = name.indexOf(QLatin1Char('.'));
+            if (pos >= 0)
+                name.truncate(pos);
+
+            QString country;
+            pos = name.indexOf(QLatin1Char('_'));
+            if (pos >= 0) {
+                country = name.mid(pos + 1);
+                name.truncate(pos);
+            }
+
+            if (!country.isEmpty() && !modifier.isEmpty())
+                names.append(name + QLatin1Char('_') + country + QLatin1Char('@') + modifier);
+            if (!country.isEmpty())
+                names.append(name + QLatin1Char('_') + country);
+            if (!modifier.isEmpty())
+                names.append(name + QLatin1Char('@') + modifier);
+            if (!name.isEmpty())
+                names.append(name);
+        }
+
+        QStringList names;
+    };
+
+    inline bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t';
+    }
+}
+
+Q_GLOBAL_STATIC(KeyTable, s_keyTable)
+Q_GLOBAL_STATIC(LocaleNames, s_localeNames)
+
+/*
+ * VDesktopEntryParser
+ */
+
+bool VDesktopEntryParser::parseFile(const QString &fileName, Values &values)
+{
+    values.clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // Parse straight from the page cache when possible
+    const qint64 size = file.size();
+    if (uchar *data = file.map(0, size)) {
+        const bool result = parse(reinterpret_cast<const char *>(data), size, values);
+        file.unmap(data);
+        return result;
+    }
+
+    const QByteArray data = file.readAll();
+    return parse(data.constData(), data.size(), values);
+}
+
+bool VDesktopEntryParser::parse(const char *data, qint64 size, Values &values)
+{
+    values.clear();
+
+    const char *p = data;
+    const char *end = data + size;
+
+    // Skip the UTF-8 byte order mark
+    if (size >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+        p += 3;
+
+    bool inGroup = false;
+    while (p < end) {
+        const char *lineEnd = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (!lineEnd)
+            lineEnd = end;
+
+        const char *s = p;
+        const char *e = lineEnd;
+        p = lineEnd < end ? lineEnd + 1 : end;
+
+        if (e > s && e[-1] == '\r')
+            --e;
+        while (s < e && isSpace(*s))
+            ++s;
+
+        // Blank lines and comments
+        if (s == e || *s == '#')
+            continue;
+
+        if (*s == '[') {
+            // Nothing else is of interest after our group
+            if (inGroup)
+                break;
+
+            static const char group[] = "Desktop Entry";
+            const int groupSize = sizeof(group) - 1;
+            inGroup = e - s >= groupSize + 2 && s[groupSize + 1] == ']' &&
+                      memcmp(s + 1, group, groupSize) == 0;
+            continue;
+        }
+
+        if (!inGroup)
+            continue;
+
+        const char *equal = static_cast<const char *>(memchr(s, '=', e - s));
+        if (!equal)
+            continue;
+
+        const char *keyEnd = equal;
+        while (keyEnd > s && isSpace(keyEnd[-1]))
+            --keyEnd;
+        if (keyEnd == s)
+            continue;
+
+        const char *v = equal + 1;
+        while (v < e && isSpace(*v))
+            ++v;
+
+        // Keys are not supposed to appear twice, the first one wins
+        const QString k = key(s, keyEnd - s);
+        if (!values.contains(k))
+            values.insert(k, value(v, e - v));
+    }
+
+    return !values.isEmpty();
+}
+
+QString VDesktopEntryParser::toString(const QString &value)
+{
+    if (!value.contains(QLatin1Char('\\')))
+        return value;
+
+    QString result;
+    result.reserve(value.size());
+
+    const QChar *c = value.constData();
+    const QChar *end = c + value.size();
+    for (; c < end; ++c) {
+        if (*c == QLatin1Char('\\') && c + 1 < end &&
+                (c[1] == QLatin1Char('\\') || c[1] == QLatin1Char(';')))
+            ++c;
+        result.append(*c);
+    }
+
+    return result;
+}
+
+bool VDesktopEntryParser::toBool(const QString &value, bool defaultValue)
+{
+    if (value.isEmpty())
+        return defaultValue;
+
+    // Older files use 0 and 1
+    return value == QLatin1String("true") || value == QLatin1String("1");
+}
+
+QStringList VDesktopEntryParser::toList(const QString &value)
+{
+    QStringList result;
+
+    QString item;
+    const QChar *c = value.constData();
+    const QChar *end = c + value.size();
+    for (; c < end; ++c) {
+        if (*c == QLatin1Char('\\') && c + 1 < end &&
+                (c[1] == QLatin1Char('\\') || c[1] == QLatin1Char(';'))) {
+            item.append(*(++c));
+        } else if (*c == QLatin1Char(';')) {
+            if (!item.isEmpty())
+                result.append(item);
+            item.clear();
+        } else {
+            item.append(*c);
+        }
+    }
+
+    // The trailing semicolon is optional
+    if (!item.isEmpty())
+        result.append(item);
+
+    return result;
+}
+
+QStringList VDesktopEntryParser::localeNames()
+{
+    LocaleNames *localeNames = s_localeNames();
+    return localeNames ? localeNames->names : QStringList();
+}
+
+void VDesktopEntryParser::resolveLocalized(const Values &values, Values &localized)
+{
+    localized.clear();
+
+    const QStringList names = localeNames();
+    if (names.isEmpty())
+        return;
+
+    QHash<QString, int> ranks;
+    for (Values::const_iterator it = values.constBegin(); it != values.constEnd(); ++it) {
+        const QString &k = it.key();
+        if (!k.endsWith(QLatin1Char(']')))
+            continue;
+
+        const int bracket = k.indexOf(QLatin1Char('['));
+        if (bracket <= 0)
+            continue;
+
+        const int rank = names.indexOf(k.mid(bracket + 1, k.size() - bracket - 2));
+        if (rank < 0)
+            continue;
+
+        const QString base = k.left(bracket);
+        QHash<QString, int>::iterator current = ranks.find(base);
+        if (current == ranks.end() || rank < current.value()) {
+            ranks.insert(base, rank);
+            localized.insert(base, it.value());
+        }
+    }
+}
+
+QString VDesktopEntryParser::key(const char *data, int size)
+{
+    const QByteArray raw = QByteArray::fromRawData(data, size);
+
+    KeyTable *table = s_keyTable();
+    if (!table)
+        return QString::fromUtf8(data, size);
+
+    QMutexLocker locker(&table->mutex);
+    QHash<QByteArray, QString>::const_iterator it = table->keys.constFind(raw);
+    if (it != table->keys.constEnd())
+        return it.value();
+
+    const QString k = QString::fromUtf8(data, size);
+    table->keys.insert(QByteArray(data, size), k);
+    return k;
+}
+
+QString VDesktopEntryParser::value(const char *data, int size)
+{
+    // Most values don't have any escape sequence
+    if (!memchr(data, '\\', size))
+        return QString::fromUtf8(data, size);
+
+    QVarLengthArray<char, 256> buffer;
+    const char *end = data + size;
+    for (const char *c = data; c < end; ++c) {
+        if (*c != '\\' || c + 1 == end) {
+            buffer.append(*c);
+            continue;
+        }
+
+        switch (c[1]) {
+        case 's':
+            buffer.append(' ');
+            break;
+        case 'n':
+            buffer.append('\n');
+            break;
+        case 't':
+            buffer.append('\t');
+            break;
+        case 'r':
+            buffer.append('\r');
+            break;
+        default:
+            // Depends on the type, see toString() and toList()
+            buffer.append('\\');
+            buffer.append(c[1]);
+            break;
+        }
+        ++c;
+    }
+
+    return QString::fromUtf8(buffer.constData(), buffer.size());
+}
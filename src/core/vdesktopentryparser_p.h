@@ -0,0 +1,78 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#ifndef VDESKTOPENTRYPARSER_P_H
+#define VDESKTOPENTRYPARSER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Vibe API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+/*
+ * Reads the "Desktop Entry" group of a desktop file in a single pass.
+ *
+ * Values keep "\\" and "\;" escaped because their meaning depends on the
+ * type of the key, toString() and toList() take care of them.  All the
+ * other escape sequences are resolved while parsing.
+ */
+class VIBECORE_EXPORT VDesktopEntryParser
+{
+public:
+    typedef QHash<QString, QString> Values;
+
+    static bool parseFile(const QString &fileName, Values &values);
+    static bool parse(const char *data, qint64 size, Values &values);
+
+    // Typed values as described by the specification
+    static QString toString(const QString &value);
+    static bool toBool(const QString &value, bool defaultValue = false);
+    static QStringList toList(const QString &value);
+
+    // Locale names to look for, most specific first
+    static QStringList localeNames();
+
+    // Best translation of each localized key for the current locale,
+    // keyed by the name without locale
+    static void resolveLocalized(const Values &values, Values &localized);
+
+private:
+    static QString key(const char *data, int size);
+    static QString value(const char *data, int size);
+};
+
+#endif // VDESKTOPENTRYPARSER_P_H
@@ -28,17 +28,19 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
-#include <QFileSystemWatcher>
+#include <QHash>
 #include <QTextStream>
 #include <QVariant>
+#include <QSet>
 #include <QStandardPaths>
 #include <QStringList>
 #include <QUrl>
-#include <QLocale>
-#include <QSettings>
 
 #include "vdesktopfile.h"
 #include "vdesktopfile_p.h"
+#include "vdesktopfiledatabase.h"
+#include "vdesktopfiledatabase_p.h"
+#include "vdesktopentryparser_p.h"
 
 /*
  * VDesktopFilePrivate
@@ -48,52 +50,81 @@ VDesktopFilePrivate::VDesktopFilePrivate(const QString &_fileName, VDesktopFile
     : fileName(_fileName)
     , q_ptr(self)
 {
-    // Read desktop file
-    file = new QSettings(fileName, QSettings::IniFormat);
-    file->beginGroup("Desktop Entry");
-    isValid = file->allKeys().size() > 0;
-
-    // Watch for changes
-    watcher = new QFileSystemWatcher(q_ptr);
-    watcher->addPath(fileName);
+    read();
+    watch();
 }
 
 VDesktopFilePrivate::~VDesktopFilePrivate()
 {
-    delete watcher;
+    unwatch();
 }
 
 void VDesktopFilePrivate::read()
 {
-    // Read desktop file
-    delete file;
-    file = new QSettings(fileName, QSettings::IniFormat);
-    file->beginGroup("Desktop Entry");
-    isValid = file->allKeys().size() > 0;
+    // Desktop files known to the database are not parsed again
+    VDesktopFileDatabase *database = VDesktopFileDatabase::instance();
+    if (!database || !database->d_func()->lookup(fileName, items))
+        VDesktopFileDatabasePrivate::parse(fileName, items);
+    isValid = items.size() > 0;
+
+    // Pick translations once rather than on each access
+    VDesktopEntryParser::resolveLocalized(items, localizedItems);
+}
+
+void VDesktopFilePrivate::watch()
+{
+    // The database watches the directory rather than the file
+    // and tells us when it changes
+    if (VDesktopFileDatabase *database = VDesktopFileDatabase::instance())
+        database->d_func()->addView(this);
+}
+
+void VDesktopFilePrivate::unwatch()
+{
+    if (VDesktopFileDatabase *database = VDesktopFileDatabase::instance())
+        database->d_func()->removeView(this);
 }
 
 bool VDesktopFilePrivate::contains(const QString &key) const
 {
-    return file->contains(key);
+    return items.contains(key);
 }
 
 QVariant VDesktopFilePrivate::value(const QString &key, const QVariant &defaultValue) const
 {
-    QVariant val = file->value(key, defaultValue);
-    return val.toString().replace(QLatin1Char('&'), QLatin1String("&&"));
+    QHash<QString, QString>::const_iterator it = items.constFind(key);
+    if (it == items.constEnd())
+        return defaultValue.toString().replace(QLatin1Char('&'), QLatin1String("&&"));
+    return VDesktopEntryParser::toString(it.value()).replace(QLatin1Char('&'), QLatin1String("&&"));
 }
 
 QVariant VDesktopFilePrivate::localizedValue(const QString &key, const QVariant &defaultValue) const
 {
-    QLocale locale = QLocale::system();
-
-    QString k = QString("%1[%2]").arg(key, locale.name());
-    if (contains(k))
-        return value(k, defaultValue);
+    QHash<QString, QString>::const_iterator it = localizedItems.constFind(key);
+    if (it != localizedItems.constEnd())
+        return VDesktopEntryParser::toString(it.value()).replace(QLatin1Char('&'), QLatin1String("&&"));
 
     return value(key, defaultValue);
 }
 
+QString VDesktopFilePrivate::stringValue(const QString &key, const QString &defaultValue) const
+{
+    QHash<QString, QString>::const_iterator it = items.constFind(key);
+    if (it == items.constEnd())
+        return defaultValue;
+    return VDesktopEntryParser::toString(it.value());
+}
+
+bool VDesktopFilePrivate::boolValue(const QString &key, bool defaultValue) const
+{
+    return VDesktopEntryParser::toBool(items.value(key), defaultValue);
+}
+
+QStringList VDesktopFilePrivate::listValue(const QString &key) const
+{
+    return VDesktopEntryParser::toList(items.value(key));
+}
+
 bool VDesktopFilePrivate::checkTryExec(const QString &program) const
 {
     // Check if a full path was provided
@@ -111,10 +142,18 @@ bool VDesktopFilePrivate::checkTryExec(const QString &program) const
 
 void VDesktopFilePrivate::_q_fileChanged(const QString &_fileName)
 {
+    Q_UNUSED(_fileName);
+
     // Read the file again
-    fileName = _fileName;
+    // Implicitly shared, keeping the previous values costs nothing
+    const bool wasValid = isValid;
+    const QHash<QString, QString> previousItems = items;
     read();
 
+    // Touched but not really changed
+    if (isValid == wasValid && items == previousItems)
+        return;
+
     // Notify that the desktop file has changed
     emit q_ptr->changed(fileName);
 }
@@ -127,8 +166,6 @@ VDesktopFile::VDesktopFile(const QString &fileName)
     : QObject()
     , d_ptr(new VDesktopFilePrivate(fileName, this))
 {
-    connect(d_ptr->watcher, SIGNAL(fileChanged(QString)),
-            this, SLOT(_q_fileChanged(QString)));
 }
 
 VDesktopFile::~VDesktopFile()
@@ -140,12 +177,14 @@ bool VDesktopFile::load(const QString &fileName)
 {
     Q_D(VDesktopFile);
 
+    d->unwatch();
     if (QFile::exists(fileName))
         d->fileName = fileName;
     else
         d->fileName = QStandardPaths::locate(QStandardPaths::GenericDataLocation,
                                              QStringLiteral("applications/%1").arg(fileName));
     d->read();
+    d->watch();
     return d->isValid;
 }
 
@@ -186,13 +225,13 @@ VDesktopFile::Type VDesktopFile::type() const
 QString VDesktopFile::typeName() const
 {
     Q_D(const VDesktopFile);
-    return d->value("Type").toString();
+    return d->stringValue("Type");
 }
 
 QString VDesktopFile::version() const
 {
     Q_D(const VDesktopFile);
-    return d->value("Version", "1.0").toString();
+    return d->stringValue("Version", "1.0");
 }
 
 QString VDesktopFile::name() const
@@ -224,11 +263,11 @@ bool VDesktopFile::isHidden() const
     Q_D(const VDesktopFile);
 
     // Application exists but should be hidden in the menu
-    if (d->value("NoDisplay").toBool())
+    if (d->boolValue("NoDisplay"))
         return true;
 
     // User deleted this application at his level
-    if (d->value("Hidden").toBool())
+    if (d->boolValue("Hidden"))
         return true;
 
     return false;
@@ -253,19 +292,19 @@ bool VDesktopFile::isHiddenFor(const QString &environment) const
 QStringList VDesktopFile::onlyShowIn() const
 {
     Q_D(const VDesktopFile);
-    return d->value("OnlyShowIn").toString().split(';', QString::SkipEmptyParts);
+    return d->listValue("OnlyShowIn");
 }
 
 QStringList VDesktopFile::notShowIn() const
 {
     Q_D(const VDesktopFile);
-    return d->value("NotShowIn").toString().split(';', QString::SkipEmptyParts);
+    return d->listValue("NotShowIn");
 }
 
 QString VDesktopFile::tryExecutePath() const
 {
     Q_D(const VDesktopFile);
-    return d->value("TryExec").toString();
+    return d->stringValue("TryExec");
 }
 
 bool VDesktopFile::isExecutable() const
@@ -288,31 +327,31 @@ bool VDesktopFile::isExecutable() const
 QString VDesktopFile::executeCommand() const
 {
     Q_D(const VDesktopFile);
-    return d->value("Exec").toString();
+    return d->stringValue("Exec");
 }
 
 QDir VDesktopFile::workingDirectory() const
 {
     Q_D(const VDesktopFile);
-    return QDir(d->value("Path").toString());
+    return QDir(d->stringValue("Path"));
 }
 
 bool VDesktopFile::runInTerminal() const
 {
     Q_D(const VDesktopFile);
-    return d->value("Terminal").toBool();
+    return d->boolValue("Terminal");
 }
 
 QStringList VDesktopFile::supportedMimeTypes() const
 {
     Q_D(const VDesktopFile);
-    return d->value("MimeType").toString().split(';', QString::SkipEmptyParts);
+    return d->listValue("MimeType");
 }
 
 QStringList VDesktopFile::categories() const
 {
     Q_D(const VDesktopFile);
-    return d->value("Categories").toString().split(';', QString::SkipEmptyParts);
+    return d->listValue("Categories");
 }
 
 // TODO StartupNotify and StartupWMClass
@@ -320,7 +359,7 @@ QStringList VDesktopFile::categories() const
 QUrl VDesktopFile::url() const
 {
     Q_D(const VDesktopFile);
-    return d->value("URL").toUrl();
+    return QUrl(d->stringValue("URL"));
 }
 
 #include "moc_vdesktopfile.cpp"
@@ -63,6 +63,9 @@ class VDesktopFilePrivate;
  *
  * This class implements version 1.0 of the standard.
  *
+ * Desktop files can be created on any thread, changed() is emitted
+ * on the thread the object lives in.
+ *
  * @author Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
  */
 class VIBECORE_EXPORT VDesktopFile : public QObject
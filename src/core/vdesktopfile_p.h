@@ -47,6 +47,8 @@ public:
     ~VDesktopFilePrivate();
 
     void read();
+    void watch();
+    void unwatch();
 
     bool contains(const QString &key) const;
 
@@ -54,18 +56,23 @@ public:
 
     QVariant localizedValue(const QString &key, const QVariant &defaultValue = QVariant()) const;
 
+    QString stringValue(const QString &key, const QString &defaultValue = QString()) const;
+    bool boolValue(const QString &key, bool defaultValue = false) const;
+    QStringList listValue(const QString &key) const;
+
     bool checkTryExec(const QString &program) const;
 
     void _q_fileChanged(const QString &_fileName);
 
     QString fileName;
     bool isValid;
-    QHash<QString, QVariant> items;
-    QSettings *file;
-    QFileSystemWatcher *watcher;
+    QHash<QString, QString> items;
+    QHash<QString, QString> localizedItems;
 
 protected:
     VDesktopFile *const q_ptr;
+
+    friend class VDesktopFileDatabasePrivate;
 };
 
 #endif // VDESKTOPFILE_P_H
@@ -0,0 +1,518 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThread>
+
+#include <VibeCore/VFileSystemWatcher>
+#include <VibeCore/VSaveFile>
+
+#include "vdesktopfile.h"
+#include "vdesktopfile_p.h"
+#include "vdesktopfiledatabase.h"
+#include "vdesktopfiledatabase_p.h"
+#include "vdesktopentryparser_p.h"
+
+static const quint32 s_cacheMagic = 0x56444442; // "VDDB"
+static const quint32 s_cacheVersion = 2;
+
+/*
+ * VDesktopFileDatabaseSingleton
+ */
+
+class VDesktopFileDatabaseSingleton
+{
+public:
+    VDesktopFileDatabase self;
+};
+
+Q_GLOBAL_STATIC(VDesktopFileDatabaseSingleton, s_desktopFileDatabase)
+
+/*
+ * VDesktopFileDatabasePrivate
+ */
+
+VDesktopFileDatabasePrivate::VDesktopFileDatabasePrivate(VDesktopFileDatabase *self)
+    : loaded(false)
+    , q_ptr(self)
+{
+    cacheFileName = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) +
+                    QLatin1String("/vibe/desktopfiles.cache");
+
+    foreach (const QString &path, QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation))
+        roots.append(cleanPath(path));
+    roots.removeDuplicates();
+}
+
+QString VDesktopFileDatabasePrivate::cleanPath(const QString &path)
+{
+    return QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+}
+
+qint64 VDesktopFileDatabasePrivate::modificationTime(const QFileInfo &info)
+{
+    if (!info.exists())
+        return -1;
+    return info.lastModified().toMSecsSinceEpoch();
+}
+
+bool VDesktopFileDatabasePrivate::parse(const QString &fileName, Values &values)
+{
+    return VDesktopEntryParser::parseFile(fileName, values);
+}
+
+bool VDesktopFileDatabasePrivate::lookup(const QString &fileName, Values &values) const
+{
+    QMutexLocker locker(&mutex);
+
+    if (!loaded)
+        return false;
+
+    QHash<QString, Entry>::const_iterator it = entries.constFind(cleanPath(fileName));
+    if (it == entries.constEnd())
+        return false;
+
+    values = it.value().values;
+    return true;
+}
+
+void VDesktopFileDatabasePrivate::addView(VDesktopFilePrivate *view)
+{
+    QMutexLocker locker(&mutex);
+
+    views.insert(cleanPath(view->fileName), view);
+    watchFile(view->fileName);
+}
+
+void VDesktopFileDatabasePrivate::removeView(VDesktopFilePrivate *view)
+{
+    QMutexLocker locker(&mutex);
+
+    views.remove(cleanPath(view->fileName), view);
+}
+
+void VDesktopFileDatabasePrivate::watchFile(const QString &fileName)
+{
+    const QFileInfo info(fileName);
+    const QString path = cleanPath(info.absolutePath());
+
+    QHash<QString, qint64> &files = watchedFiles[path];
+    const QString file = cleanPath(fileName);
+    if (!files.contains(file))
+        files.insert(file, modificationTime(info));
+
+    watchDirectory(path);
+}
+
+void VDesktopFileDatabasePrivate::watchDirectory(const QString &path)
+{
+    if (watchedDirectories.contains(path))
+        return;
+
+    // The watcher is only used on the thread the database lives in
+    watchedDirectories.insert(path);
+    QMetaObject::invokeMethod(q_ptr, "_q_watchDirectory", Qt::AutoConnection,
+                              Q_ARG(QString, path));
+}
+
+void VDesktopFileDatabasePrivate::scanDirectory(const QString &path, ScanMode mode,
+                                                Changes &changes)
+{
+    const QFileInfo info(path);
+    if (!info.isDir()) {
+        removeDirectory(path, changes);
+        return;
+    }
+
+    watchDirectory(path);
+
+    const qint64 modified = modificationTime(info);
+    QHash<QString, Directory>::const_iterator it = directories.constFind(path);
+
+    // Subdirectories are scanned the same way unless only this one changed
+    const ScanMode subdirectoryMode = mode == ScanTree ? ScanTree : ScanChangedDirectories;
+
+    // No file was added or removed since the last scan and changes to
+    // existing files are reported by the watcher, only look deeper
+    if (mode == ScanChangedDirectories && it != directories.constEnd() && it.value().modified == modified) {
+        const QStringList subdirectories = it.value().subdirectories;
+        foreach (const QString &subdirectory, subdirectories)
+            scanDirectory(subdirectory, subdirectoryMode, changes);
+        return;
+    }
+
+    const Directory previous = it != directories.constEnd() ? it.value() : Directory();
+
+    Directory directory;
+    directory.modified = modified;
+
+    const QFileInfoList list = QDir(path).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+    foreach (const QFileInfo &fileInfo, list) {
+        const QString fileName = path + QLatin1Char('/') + fileInfo.fileName();
+
+        if (fileInfo.isDir()) {
+            directory.subdirectories.append(fileName);
+        } else if (fileName.endsWith(QLatin1String(".desktop"))) {
+            directory.files.append(fileName);
+            updateEntry(fileName, modificationTime(fileInfo), changes);
+        }
+    }
+
+    directories.insert(path, directory);
+
+    const QSet<QString> files = directory.files.toSet();
+    foreach (const QString &fileName, previous.files) {
+        if (!files.contains(fileName)) {
+            entries.remove(fileName);
+            changes.removed.append(fileName);
+        }
+    }
+
+    const QSet<QString> subdirectories = directory.subdirectories.toSet();
+    foreach (const QString &subdirectory, previous.subdirectories) {
+        if (!subdirectories.contains(subdirectory))
+            removeDirectory(subdirectory, changes);
+    }
+
+    foreach (const QString &subdirectory, directory.subdirectories)
+        scanDirectory(subdirectory, subdirectoryMode, changes);
+}
+
+void VDesktopFileDatabasePrivate::removeDirectory(const QString &path, Changes &changes)
+{
+    QHash<QString, Directory>::iterator it = directories.find(path);
+    if (it == directories.end())
+        return;
+
+    const Directory directory = it.value();
+    directories.erase(it);
+
+    foreach (const QString &fileName, directory.files) {
+        entries.remove(fileName);
+        changes.removed.append(fileName);
+    }
+
+    foreach (const QString &subdirectory, directory.subdirectories)
+        removeDirectory(subdirectory, changes);
+}
+
+void VDesktopFileDatabasePrivate::updateEntry(const QString &fileName, qint64 modified,
+                                              Changes &changes)
+{
+    QHash<QString, Entry>::iterator it = entries.find(fileName);
+    if (it != entries.end() && it.value().modified == modified)
+        return;
+
+    Entry entry;
+    entry.modified = modified;
+    parse(fileName, entry.values);
+
+    if (it == entries.end()) {
+        entries.insert(fileName, entry);
+        changes.added.append(fileName);
+    } else {
+        it.value() = entry;
+        changes.changed.append(fileName);
+    }
+}
+
+bool VDesktopFileDatabasePrivate::readCache()
+{
+    QFile file(cacheFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (magic != s_cacheMagic || version != s_cacheVersion)
+        return false;
+
+    // Directories are different, for example XDG_DATA_DIRS was changed
+    QStringList cachedRoots;
+    stream >> cachedRoots;
+    if (cachedRoots != roots)
+        return false;
+
+    qint32 count;
+    stream >> count;
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString path;
+        Directory directory;
+        stream >> path >> directory.modified >> directory.files >> directory.subdirectories;
+        directories.insert(path, directory);
+    }
+
+    stream >> count;
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString fileName;
+        Entry entry;
+        stream >> fileName >> entry.modified >> entry.values;
+        entries.insert(fileName, entry);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qWarning("Desktop files cache %s is corrupted, ignoring it", qPrintable(cacheFileName));
+        directories.clear();
+        entries.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void VDesktopFileDatabasePrivate::writeCache() const
+{
+    QDir().mkpath(QFileInfo(cacheFileName).absolutePath());
+
+    VSaveFile file(cacheFileName);
+    if (!file.open()) {
+        qWarning("Unable to write desktop files cache %s: %s",
+                 qPrintable(cacheFileName), qPrintable(file.errorString()));
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << s_cacheMagic << s_cacheVersion << roots;
+
+    stream << qint32(directories.size());
+    for (QHash<QString, Directory>::const_iterator it = directories.constBegin();
+            it != directories.constEnd(); ++it)
+        stream << it.key() << it.value().modified << it.value().files << it.value().subdirectories;
+
+    stream << qint32(entries.size());
+    for (QHash<QString, Entry>::const_iterator it = entries.constBegin();
+            it != entries.constEnd(); ++it)
+        stream << it.key() << it.value().modified << it.value().values;
+
+    if (!file.finalize())
+        qWarning("Unable to write desktop files cache %s: %s",
+                 qPrintable(cacheFileName), qPrintable(file.errorString()));
+}
+
+void VDesktopFileDatabasePrivate::notify(const Changes &changes)
+{
+    Q_Q(VDesktopFileDatabase);
+
+    // Views first, so that they are up to date when the signals are emitted;
+    // views living on other threads are told on their thread, they cannot
+    // be deleted while the mutex is held
+    const QStringList fileNames = changes.removed + changes.added + changes.changed;
+    foreach (const QString &fileName, fileNames) {
+        mutex.lock();
+        QList<VDesktopFilePrivate *> list;
+        QMultiHash<QString, VDesktopFilePrivate *>::const_iterator it = views.constFind(fileName);
+        for (; it != views.constEnd() && it.key() == fileName; ++it) {
+            VDesktopFilePrivate *view = it.value();
+            if (view->q_ptr->thread() == QThread::currentThread())
+                list.append(view);
+            else
+                QMetaObject::invokeMethod(view->q_ptr, "_q_fileChanged", Qt::QueuedConnection,
+                                          Q_ARG(QString, fileName));
+        }
+        mutex.unlock();
+
+        foreach (VDesktopFilePrivate *view, list) {
+            // A view might be deleted by another one's change handler
+            mutex.lock();
+            const bool alive = views.contains(fileName, view);
+            mutex.unlock();
+            if (alive)
+                view->_q_fileChanged(fileName);
+        }
+    }
+
+    foreach (const QString &fileName, changes.removed)
+        Q_EMIT q->entryRemoved(fileName);
+    foreach (const QString &fileName, changes.added)
+        Q_EMIT q->entryAdded(fileName);
+    foreach (const QString &fileName, changes.changed)
+        Q_EMIT q->entryChanged(fileName);
+}
+
+void VDesktopFileDatabasePrivate::_q_connectWatcher()
+{
+    Q_Q(VDesktopFileDatabase);
+
+    VFileSystemWatcher *watcher = VFileSystemWatcher::self();
+    QObject::connect(watcher, SIGNAL(dirty(QString)), q, SLOT(_q_pathChanged(QString)));
+    QObject::connect(watcher, SIGNAL(created(QString)), q, SLOT(_q_pathChanged(QString)));
+    QObject::connect(watcher, SIGNAL(deleted(QString)), q, SLOT(_q_pathChanged(QString)));
+}
+
+void VDesktopFileDatabasePrivate::_q_watchDirectory(const QString &path)
+{
+    VFileSystemWatcher::self()->addDir(path);
+}
+
+void VDesktopFileDatabasePrivate::_q_pathChanged(const QString &_path)
+{
+    const QString path = cleanPath(_path);
+
+    mutex.lock();
+
+    // Either a directory or a file inside a directory we know about
+    QString directory = path;
+    if (!directories.contains(directory) && !roots.contains(directory) &&
+            !watchedFiles.contains(directory))
+        directory = cleanPath(QFileInfo(path).absolutePath());
+
+    Changes changes;
+
+    const bool tracked = loaded && (directories.contains(directory) || roots.contains(directory));
+    if (tracked)
+        scanDirectory(directory, ScanDirectory, changes);
+
+    QHash<QString, QHash<QString, qint64> >::iterator files = watchedFiles.find(directory);
+    if (files != watchedFiles.end()) {
+        for (QHash<QString, qint64>::iterator it = files.value().begin();
+                it != files.value().end(); ++it) {
+            // Already taken care of
+            if (loaded && entries.contains(it.key()))
+                continue;
+
+            const qint64 modified = modificationTime(QFileInfo(it.key()));
+            if (modified == it.value())
+                continue;
+
+            if (modified < 0)
+                changes.removed.append(it.key());
+            else if (it.value() < 0)
+                changes.added.append(it.key());
+            else
+                changes.changed.append(it.key());
+            it.value() = modified;
+        }
+    }
+
+    if (tracked && !changes.isEmpty())
+        writeCache();
+
+    mutex.unlock();
+
+    notify(changes);
+}
+
+/*
+ * VDesktopFileDatabase
+ */
+
+VDesktopFileDatabase::VDesktopFileDatabase()
+    : QObject()
+    , d_ptr(new VDesktopFileDatabasePrivate(this))
+{
+    // The first desktop file might be created on a worker thread,
+    // the database and the watcher belong to the application thread
+    if (QCoreApplication::instance())
+        moveToThread(QCoreApplication::instance()->thread());
+    QMetaObject::invokeMethod(this, "_q_connectWatcher", Qt::AutoConnection);
+}
+
+VDesktopFileDatabase::~VDesktopFileDatabase()
+{
+    delete d_ptr;
+}
+
+VDesktopFileDatabase *VDesktopFileDatabase::instance()
+{
+    VDesktopFileDatabaseSingleton *singleton = s_desktopFileDatabase();
+    return singleton ? &singleton->self : 0;
+}
+
+void VDesktopFileDatabase::load()
+{
+    Q_D(VDesktopFileDatabase);
+
+    QMutexLocker locker(&d->mutex);
+
+    if (d->loaded)
+        return;
+    d->loaded = true;
+
+    const bool cached = d->readCache();
+
+    // Changes are not notified, nobody saw the old entries; files are
+    // checked one by one, they might have been edited in place while
+    // nobody was watching
+    VDesktopFileDatabasePrivate::Changes changes;
+    foreach (const QString &root, d->roots) {
+        // Roots are watched even when missing, they might be created later
+        d->watchDirectory(root);
+        d->scanDirectory(root, VDesktopFileDatabasePrivate::ScanTree, changes);
+    }
+
+    if (!cached || !changes.isEmpty())
+        d->writeCache();
+}
+
+bool VDesktopFileDatabase::isLoaded() const
+{
+    Q_D(const VDesktopFileDatabase);
+    QMutexLocker locker(&d->mutex);
+    return d->loaded;
+}
+
+QStringList VDesktopFileDatabase::directories() const
+{
+    Q_D(const VDesktopFileDatabase);
+    return d->roots;
+}
+
+QStringList VDesktopFileDatabase::fileNames()
+{
+    Q_D(VDesktopFileDatabase);
+    load();
+    QMutexLocker locker(&d->mutex);
+    return d->entries.keys();
+}
+
+bool VDesktopFileDatabase::contains(const QString &fileName)
+{
+    Q_D(VDesktopFileDatabase);
+    load();
+    QMutexLocker locker(&d->mutex);
+    return d->entries.contains(VDesktopFileDatabasePrivate::cleanPath(fileName));
+}
+
+QString VDesktopFileDatabase::cacheFileName() const
+{
+    Q_D(const VDesktopFileDatabase);
+    return d->cacheFileName;
+}
+
+#include "moc_vdesktopfiledatabase.cpp"
@@ -0,0 +1,124 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#ifndef VDESKTOPFILEDATABASE_H
+#define VDESKTOPFILEDATABASE_H
+
+#include <QObject>
+#include <QStringList>
+
+#include <VibeCore/VibeCoreExport>
+
+class VDesktopFileDatabasePrivate;
+
+/** \addtogroup core Core Kit
+ *  @{
+ */
+
+/**
+ * \class VDesktopFileDatabase vdesktopfiledatabase.h <VDesktopFileDatabase>
+ * @brief Cache of the desktop entries installed on the system.
+ * The database scans the XDG applications directories, parses every
+ * desktop file it finds and keeps all the keys, localized ones included,
+ * in a cache file.  Next time the cache is loaded and only desktop
+ * files whose modification time changed are parsed again.
+ *
+ * Directories are watched with the shared VFileSystemWatcher instead of
+ * watching each file, entries are updated as soon as they change on disk.
+ *
+ * Once the database is loaded, VDesktopFile objects for files it knows
+ * about are views on the cached entries and don't parse anything.
+ * The database is loaded on first use of fileNames() or load().
+ *
+ * The database can be used from any thread, it lives on the thread of
+ * the application object and signals are emitted there.
+ * @author Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ */
+class VIBECORE_EXPORT VDesktopFileDatabase : public QObject
+{
+    Q_OBJECT
+public:
+    //! Destructs the VDesktopFileDatabase object.
+    ~VDesktopFileDatabase();
+
+    /**
+     * Returns the database shared by the whole process, or 0
+     * if it was already destroyed on exit.
+     */
+    static VDesktopFileDatabase *instance();
+
+    /**
+     * Loads the cache and parses the desktop files that changed since
+     * it was written, does nothing if the database is already loaded.
+     */
+    void load();
+
+    //! Returns whether the database was loaded.
+    bool isLoaded() const;
+
+    //! Applications directories being scanned, subdirectories excluded.
+    QStringList directories() const;
+
+    //! Full paths of all the known desktop files.
+    QStringList fileNames();
+
+    /**
+     * Returns whether a desktop file is in the database.
+     * \param fileName Full path of the desktop file.
+     */
+    bool contains(const QString &fileName);
+
+    //! Full path of the cache file.
+    QString cacheFileName() const;
+
+signals:
+    //! A desktop file was added to one of the directories.
+    void entryAdded(const QString &fileName);
+
+    //! A desktop file was modified.
+    void entryChanged(const QString &fileName);
+
+    //! A desktop file was removed.
+    void entryRemoved(const QString &fileName);
+
+private:
+    VDesktopFileDatabase();
+
+    Q_DECLARE_PRIVATE(VDesktopFileDatabase)
+    Q_PRIVATE_SLOT(d_ptr, void _q_connectWatcher())
+    Q_PRIVATE_SLOT(d_ptr, void _q_watchDirectory(const QString &))
+    Q_PRIVATE_SLOT(d_ptr, void _q_pathChanged(const QString &))
+
+    VDesktopFileDatabasePrivate *const d_ptr;
+
+    friend class VDesktopFilePrivate;
+    friend class VDesktopFileDatabaseSingleton;
+};
+
+/** @}*/
+
+#endif // VDESKTOPFILEDATABASE_H
@@ -0,0 +1,134 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:LGPL2$
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as published by
+ * the Free Software Foundation; version 2.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * $END_LICENSE$
+ ***************************************************************************/
+
+#ifndef VDESKTOPFILEDATABASE_P_H
+#define VDESKTOPFILEDATABASE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Vibe API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QMutex>
+
+class QFileInfo;
+
+class VDesktopFilePrivate;
+
+class VIBECORE_EXPORT VDesktopFileDatabasePrivate
+{
+    Q_DECLARE_PUBLIC(VDesktopFileDatabase)
+public:
+    typedef QHash<QString, QString> Values;
+
+    struct Entry {
+        Entry() : modified(-1) {}
+
+        qint64 modified;
+        Values values;
+    };
+
+    struct Directory {
+        Directory() : modified(-1) {}
+
+        qint64 modified;
+        QStringList files;
+        QStringList subdirectories;
+    };
+
+    enum ScanMode {
+        // Only scan directories whose modification time changed
+        ScanChangedDirectories,
+        // Scan this directory, then only those that changed below it
+        ScanDirectory,
+        // Scan everything, files are parsed again only if they changed
+        ScanTree
+    };
+
+    struct Changes {
+        bool isEmpty() const {
+            return added.isEmpty() && changed.isEmpty() && removed.isEmpty();
+        }
+
+        QStringList added;
+        QStringList changed;
+        QStringList removed;
+    };
+
+    explicit VDesktopFileDatabasePrivate(VDesktopFileDatabase *self);
+
+    static QString cleanPath(const QString &path);
+    static qint64 modificationTime(const QFileInfo &info);
+    static bool parse(const QString &fileName, Values &values);
+
+    bool lookup(const QString &fileName, Values &values) const;
+    void addView(VDesktopFilePrivate *view);
+    void removeView(VDesktopFilePrivate *view);
+    void watchFile(const QString &fileName);
+    void watchDirectory(const QString &path);
+
+    void scanDirectory(const QString &path, ScanMode mode, Changes &changes);
+    void removeDirectory(const QString &path, Changes &changes);
+    void updateEntry(const QString &fileName, qint64 modified, Changes &changes);
+
+    bool readCache();
+    void writeCache() const;
+
+    void notify(const Changes &changes);
+
+    void _q_connectWatcher();
+    void _q_watchDirectory(const QString &path);
+    void _q_pathChanged(const QString &path);
+
+    // Desktop files can be used on any thread, this protects everything
+    // below; it is never held while views or signals are called
+    mutable QMutex mutex;
+
+    bool loaded;
+    QString cacheFileName;
+    QStringList roots;
+    QHash<QString, Directory> directories;
+    QHash<QString, Entry> entries;
+
+    // Files with VDesktopFile views the database doesn't track, by directory
+    QHash<QString, QHash<QString, qint64> > watchedFiles;
+    QSet<QString> watchedDirectories;
+
+    // VDesktopFile objects by file name, told directly about their file
+    QMultiHash<QString, VDesktopFilePrivate *> views;
+
+protected:
+    VDesktopFileDatabase *const q_ptr;
+};
+
+#endif // VDESKTOPFILEDATABASE_P_H
@@ -33,6 +33,8 @@
  * $END_LICENSE$
  ***************************************************************************/
 
+#include <string.h>
+
 #include "vstringhandler.h"
 
 /*!
@@ -66,6 +68,62 @@
 */
 namespace VStringHandler
 {
+    // Token types of a natural sort key, in the order they sort
+    enum SortKeyToken {
+        EndToken = 0x01,
+        SeparatorToken = 0x02,
+        NumberToken = 0x03,
+        TextToken = 0x04,
+        ReplacementToken = 0x05,
+        ObjectReplacementToken = 0x06
+    };
+
+    static inline void appendCodeUnit(QByteArray &key, ushort unicode)
+    {
+        key.append(char(unicode >> 8));
+        key.append(char(unicode & 0xff));
+    }
+
+    static void appendText(QByteArray &key, const QChar *begin, const QChar *end)
+    {
+        // Primary strength only: case and accents are left to the tie-breaker
+        const QString folded = QString(begin, end - begin).normalized(QString::NormalizationForm_D).toCaseFolded();
+        const QChar *c = folded.unicode();
+        const QChar *e = c + folded.size();
+        for (; c != e; ++c) {
+            if (c->category() == QChar::Mark_NonSpacing)
+                continue;
+            key.append(char(TextToken));
+            appendCodeUnit(key, c->unicode());
+        }
+    }
+
+    static void appendNumber(QByteArray &key, const QChar *begin, const QChar *end)
+    {
+        key.append(char(NumberToken));
+
+        if (begin->digitValue() == 0) {
+            // A fraction part: digits are compared left aligned, and the
+            // terminator sorts above any digit, so the shorter run sorts
+            // last when one is a prefix of the other, as naturalCompare() does
+            key.append(char(0x00));
+            for (const QChar *c = begin; c != end; ++c)
+                key.append(char(0x10 + c->digitValue()));
+            key.append(char(0x20));
+        } else {
+            // An integer: the longer run wins, then the greater value
+            const quint32 length = end - begin;
+            key.append(char(0x01));
+            key.append(char(length >> 24));
+            key.append(char((length >> 16) & 0xff));
+            key.append(char((length >> 8) & 0xff));
+            key.append(char(length & 0xff));
+            for (const QChar *c = begin; c != end; ++c)
+                key.append(char(0x10 + c->digitValue()));
+        }
+    }
+
+
     /*!
         Does a natural comparing of the strings. A negative value is returned if \a a
         is smaller than \a b. A positive value is returned if \a a is greater than \a b. 0
@@ -222,4 +280,85 @@ namespace VStringHandler
 
         return currA->isNull() ? -1 : + 1;
     }
+
+    /*!
+        Returns a binary key for \a s that can be compared with compareNaturalSortKeys()
+        (or memcmp()) to sort strings naturally, like naturalCompare() does.
+
+        Computing the key is more expensive than a single naturalCompare() call, but
+        it is done only once per string: sorting a large list is a lot faster if the
+        keys are computed beforehand and cached.
+
+        Text is compared ignoring case and accents first, falling back to the
+        original characters when two strings are otherwise equal; if \a caseSensitivity
+        is Qt::CaseInsensitive the fallback ignores case as well.  Digit sequences are
+        compared by value exactly like naturalCompare() does.
+
+        \note The key does not depend on the current locale, text is ordered by
+        Unicode code point after folding.  For most file names this gives the same
+        order of naturalCompare(), but languages with special collation rules may
+        sort differently.
+    */
+    QByteArray naturalSortKey(const QString &s, Qt::CaseSensitivity caseSensitivity)
+    {
+        QByteArray key;
+        key.reserve(s.size() * 4 + 8);
+
+        const QChar *curr = s.unicode();
+        const QChar *end = curr + s.size();
+
+        while (curr != end) {
+            const QChar *begin = curr;
+
+            if (curr->unicode() == QChar::ObjectReplacementCharacter) {
+                key.append(char(ObjectReplacementToken));
+                ++curr;
+            } else if (curr->unicode() == QChar::ReplacementCharacter) {
+                key.append(char(ReplacementToken));
+                ++curr;
+            } else if (curr->isDigit()) {
+                while (curr != end && curr->isDigit())
+                    ++curr;
+                appendNumber(key, begin, curr);
+            } else if (curr->isPunct() || curr->isSpace()) {
+                key.append(char(SeparatorToken));
+                appendCodeUnit(key, curr->unicode());
+                ++curr;
+            } else {
+                while (curr != end && !curr->isDigit() && !curr->isPunct() && !curr->isSpace() &&
+                        curr->unicode() != QChar::ObjectReplacementCharacter &&
+                        curr->unicode() != QChar::ReplacementCharacter)
+                    ++curr;
+                appendText(key, begin, curr);
+            }
+        }
+
+        key.append(char(EndToken));
+
+        // Tie-breaker for strings that differ only by case or accents
+        key.append(char(0x00));
+        const QString tieBreaker = caseSensitivity == Qt::CaseSensitive ? s : s.toLower();
+        const QChar *c = tieBreaker.unicode();
+        for (const QChar *e = c + tieBreaker.size(); c != e; ++c)
+            appendCodeUnit(key, c->unicode());
+
+        return key;
+    }
+
+    /*!
+        Compares two keys returned by naturalSortKey().  A negative value is returned if
+        \a a is smaller than \a b, a positive value if \a a is greater than \a b and 0 if
+        both keys are equal.
+    */
+    int compareNaturalSortKeys(const QByteArray &a, const QByteArray &b)
+    {
+        const int length = qMin(a.size(), b.size());
+        const int cmp = memcmp(a.constData(), b.constData(), length);
+        if (cmp != 0)
+            return cmp < 0 ? -1 : +1;
+
+        if (a.size() == b.size())
+            return 0;
+        return a.size() < b.size() ? -1 : +1;
+    }
 }
@@ -36,6 +36,7 @@
 #ifndef VSTRINGHANDLER_H
 #define VSTRINGHANDLER_H
 
+#include <QByteArray>
 #include <QString>
 
 #include <VibeCore/VibeCoreExport>
@@ -44,6 +45,11 @@ namespace VStringHandler
 {
     VIBECORE_EXPORT int naturalCompare(const QString &a, const QString &b,
                                    Qt::CaseSensitivity caseSensitivity = Qt::CaseSensitive);
+
+    VIBECORE_EXPORT QByteArray naturalSortKey(const QString &s,
+                                              Qt::CaseSensitivity caseSensitivity = Qt::CaseSensitive);
+
+    VIBECORE_EXPORT int compareNaturalSortKeys(const QByteArray &a, const QByteArray &b);
 }
 
 #endif // VSTRINGHANDLER_H
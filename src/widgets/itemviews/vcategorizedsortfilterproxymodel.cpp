@@ -31,19 +31,357 @@
 
 #include <limits.h>
 
+#include <algorithm>
+#include <typeinfo>
+
+#include <QDateTime>
 #include <QItemSelection>
+#include <QRunnable>
+#include <QSemaphore>
 #include <QStringList>
 #include <QSize>
+#include <QThread>
+#include <QThreadPool>
 
 #include <VibeCore/VStringHandler>
 
 #include "vcategorizedsortfilterproxymodel.h"
 #include "vcategorizedsortfilterproxymodel_p.h"
 
+/*
+ * Sorts a range with std::stable_sort on a chunk per core, then merges
+ * neighbouring chunks.  The comparison must not touch the source model,
+ * since it runs on worker threads of the global pool.
+ */
+template <typename LessThan>
+class StableSortChunk : public QRunnable
+{
+public:
+    StableSortChunk(int *begin, int *end, LessThan lessThan, QSemaphore *done)
+        : m_begin(begin)
+        , m_end(end)
+        , m_lessThan(lessThan)
+        , m_done(done) {
+    }
+
+    void run() {
+        std::stable_sort(m_begin, m_end, m_lessThan);
+        m_done->release();
+    }
+
+private:
+    int *m_begin;
+    int *m_end;
+    LessThan m_lessThan;
+    QSemaphore *m_done;
+};
+
+template <typename LessThan>
+static void parallelStableSort(int *begin, int *end, LessThan lessThan)
+{
+    const int count = end - begin;
+    const int threads = QThread::idealThreadCount();
+    if (count < 10000 || threads < 2) {
+        std::stable_sort(begin, end, lessThan);
+        return;
+    }
+
+    const int chunkSize = (count + threads - 1) / threads;
+    QVector<int *> bounds;
+    for (int i = 0; i < count; i += chunkSize)
+        bounds.append(begin + i);
+    bounds.append(end);
+    const int chunks = bounds.size() - 1;
+
+    // Wait for our own chunks only, the global pool may be running other
+    // work; chunks that find no free thread are sorted right here
+    QThreadPool *pool = QThreadPool::globalInstance();
+    QSemaphore done;
+    for (int i = 0; i < chunks; ++i) {
+        StableSortChunk<LessThan> *chunk =
+            new StableSortChunk<LessThan>(bounds.at(i), bounds.at(i + 1), lessThan, &done);
+        if (i == 0 || !pool->tryStart(chunk)) {
+            chunk->run();
+            delete chunk;
+        }
+    }
+    done.acquire(chunks);
+
+    // The left chunk always comes first, the merge is stable
+    for (int width = 1; width < chunks; width *= 2) {
+        for (int i = 0; i + width < chunks; i += 2 * width)
+            std::inplace_merge(bounds.at(i), bounds.at(i + width),
+                               bounds.at(qMin(i + 2 * width, chunks)), lessThan);
+    }
+}
+
+/*
+ * Mirrors QSortFilterProxyModel::lessThan() on values already read
+ * from the model.
+ */
+static bool variantLessThan(const QVariant &l, const QVariant &r,
+                            Qt::CaseSensitivity caseSensitivity, bool localeAware)
+{
+    switch (l.userType()) {
+    case QVariant::Invalid:
+        return (r.type() != QVariant::Invalid);
+    case QVariant::Int:
+        return l.toInt() < r.toInt();
+    case QVariant::UInt:
+        return l.toUInt() < r.toUInt();
+    case QVariant::LongLong:
+        return l.toLongLong() < r.toLongLong();
+    case QVariant::ULongLong:
+        return l.toULongLong() < r.toULongLong();
+    case QMetaType::Float:
+        return l.toFloat() < r.toFloat();
+    case QVariant::Double:
+        return l.toDouble() < r.toDouble();
+    case QVariant::Char:
+        return l.toChar() < r.toChar();
+    case QVariant::Date:
+        return l.toDate() < r.toDate();
+    case QVariant::Time:
+        return l.toTime() < r.toTime();
+    case QVariant::DateTime:
+        return l.toDateTime() < r.toDateTime();
+    case QVariant::String:
+    default:
+        if (localeAware)
+            return l.toString().localeAwareCompare(r.toString()) < 0;
+        return l.toString().compare(r.toString(), caseSensitivity) < 0;
+    }
+}
+
+VCategorizedSortFilterProxyModel::Private::KeySettings VCategorizedSortFilterProxyModel::Private::currentKeySettings(int column) const
+{
+    KeySettings settings;
+    settings.column = column;
+    settings.sortRole = q->sortRole();
+    settings.sortCaseSensitivity = q->sortCaseSensitivity();
+    settings.sortLocaleAware = q->isSortLocaleAware();
+    settings.categorizedModel = categorizedModel;
+    settings.sortCategoriesByNaturalComparison = sortCategoriesByNaturalComparison;
+    settings.sortKeyCacheEnabled = sortKeyCacheEnabled;
+    return settings;
+}
+
+const VCategorizedSortFilterProxyModel::Private::RowKeys *VCategorizedSortFilterProxyModel::Private::keysFor(const QModelIndex &index) const
+{
+    if (index.model() != q->sourceModel())
+        return 0;
+
+    // Settings only change along with a sort, once they were checked the
+    // index is enough: an index with the row, column and id a top level
+    // row had when its keys were extracted is that row
+    if (rowKeysChecked && index.column() == rowKeySettings.column) {
+        if (index.row() >= rowKeys.size() || rowKeys.at(index.row()).id != index.internalId())
+            return 0;
+        return rowKeys.constData() + index.row();
+    }
+
+    // Only top level rows are cached, that's what categorized views show
+    if (!index.isValid() || index.parent().isValid())
+        return 0;
+
+    const KeySettings settings = currentKeySettings(index.column());
+    rowKeysChecked = true;
+    if (!rowKeysValid || !(settings == rowKeySettings)) {
+        rowKeySettings = settings;
+        rowKeys.resize(q->sourceModel()->rowCount());
+        for (int row = 0; row < rowKeys.size(); ++row)
+            extractKeys(row, rowKeys[row]);
+        rowKeysValid = true;
+
+        // Subclasses may compare differently than the keys do
+        if (typeid(*q) == typeid(VCategorizedSortFilterProxyModel))
+            rankRows();
+    }
+
+    if (index.row() >= rowKeys.size())
+        return 0;
+    return rowKeys.constData() + index.row();
+}
+
+void VCategorizedSortFilterProxyModel::Private::extractKeys(int row, RowKeys &keys) const
+{
+    const QModelIndex index = q->sourceModel()->index(row, rowKeySettings.column);
+
+    keys = RowKeys();
+    keys.id = index.internalId();
+
+    if (rowKeySettings.categorizedModel) {
+        const QVariant category = index.data(CategorySortRole);
+        if (category.type() == QVariant::String) {
+            keys.categoryIsString = true;
+            keys.categoryString = category.toString();
+            if (rowKeySettings.sortCategoriesByNaturalComparison && rowKeySettings.sortKeyCacheEnabled)
+                keys.categoryKey = sortKey(keys.categoryString, Qt::CaseSensitive);
+        } else {
+            keys.categoryValue = category.toLongLong();
+        }
+    }
+
+    QVariant value = index.data(rowKeySettings.sortRole);
+    switch (value.userType()) {
+    case QVariant::Invalid:
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QMetaType::Float:
+    case QVariant::Double:
+    case QVariant::Char:
+    case QVariant::Date:
+    case QVariant::Time:
+    case QVariant::DateTime:
+    case QVariant::String:
+        break;
+    default:
+        // Compared as strings anyway, convert only once
+        value = value.toString();
+        break;
+    }
+    if (rowKeySettings.sortKeyCacheEnabled && value.type() == QVariant::String)
+        keys.sortKey = sortKey(value.toString(), rowKeySettings.sortCaseSensitivity);
+    keys.sortValue = value;
+}
+
+void VCategorizedSortFilterProxyModel::Private::rankRows() const
+{
+    QVector<int> rows(rowKeys.size());
+    for (int i = 0; i < rows.size(); ++i)
+        rows[i] = i;
+
+    parallelStableSort(rows.data(), rows.data() + rows.size(), RowLessThan(this));
+
+    // Equal rows share the rank, so that their relative order is left
+    // to QSortFilterProxyModel like it would be without ranks
+    RowKeys *keys = rowKeys.data();
+    int rank = 0;
+    for (int i = 0; i < rows.size(); ++i) {
+        if (i > 0 && rowLessThan(keys[rows.at(i - 1)], keys[rows.at(i)]))
+            rank = i;
+        keys[rows.at(i)].rank = rank;
+    }
+}
+
+void VCategorizedSortFilterProxyModel::Private::invalidateRowKeys()
+{
+    rowKeysValid = false;
+    rowKeysChecked = false;
+    rowKeys.clear();
+}
+
+int VCategorizedSortFilterProxyModel::Private::compareCategoryKeys(const RowKeys &left, const RowKeys &right) const
+{
+    if (left.categoryIsString) {
+        if (rowKeySettings.sortCategoriesByNaturalComparison && rowKeySettings.sortKeyCacheEnabled) {
+            return VStringHandler::compareNaturalSortKeys(left.categoryKey, right.categoryKey);
+        } else if (rowKeySettings.sortCategoriesByNaturalComparison) {
+            return VStringHandler::naturalCompare(left.categoryString, right.categoryString);
+        }
+
+        if (left.categoryString < right.categoryString)
+            return -1;
+        if (left.categoryString > right.categoryString)
+            return 1;
+        return 0;
+    }
+
+    if (left.categoryValue < right.categoryValue)
+        return -1;
+    if (left.categoryValue > right.categoryValue)
+        return 1;
+    return 0;
+}
+
+bool VCategorizedSortFilterProxyModel::Private::sortKeyLessThan(const RowKeys &left, const RowKeys &right) const
+{
+    if (rowKeySettings.sortKeyCacheEnabled &&
+            left.sortValue.type() == QVariant::String && right.sortValue.type() == QVariant::String)
+        return VStringHandler::compareNaturalSortKeys(left.sortKey, right.sortKey) < 0;
+
+    return variantLessThan(left.sortValue, right.sortValue,
+                           rowKeySettings.sortCaseSensitivity, rowKeySettings.sortLocaleAware);
+}
+
+bool VCategorizedSortFilterProxyModel::Private::rowLessThan(const RowKeys &left, const RowKeys &right) const
+{
+    if (rowKeySettings.categorizedModel) {
+        const int compare = compareCategoryKeys(left, right);
+        if (compare != 0)
+            return compare < 0;
+    }
+
+    return sortKeyLessThan(left, right);
+}
+
+bool VCategorizedSortFilterProxyModel::Private::RowLessThan::operator()(int left, int right) const
+{
+    const RowKeys *keys = d->rowKeys.constData();
+    return d->rowLessThan(keys[left], keys[right]);
+}
+
+void VCategorizedSortFilterProxyModel::Private::_k_sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if (!rowKeysValid || topLeft.parent().isValid())
+        return;
+    if (rowKeySettings.column < topLeft.column() || rowKeySettings.column > bottomRight.column())
+        return;
+
+    // Only the changed rows lose their rank, QSortFilterProxyModel moves
+    // them comparing their new keys with the others
+    const int last = qMin(bottomRight.row(), rowKeys.size() - 1);
+    for (int row = topLeft.row(); row <= last; ++row)
+        extractKeys(row, rowKeys[row]);
+}
+
+void VCategorizedSortFilterProxyModel::Private::_k_sourceRowsInserted(const QModelIndex &parent, int start, int end)
+{
+    if (!rowKeysValid || parent.isValid())
+        return;
+
+    if (start > rowKeys.size()) {
+        invalidateRowKeys();
+        return;
+    }
+
+    rowKeys.insert(start, end - start + 1, RowKeys());
+    for (int row = start; row <= end; ++row)
+        extractKeys(row, rowKeys[row]);
+}
+
+void VCategorizedSortFilterProxyModel::Private::_k_sourceRowsRemoved(const QModelIndex &parent, int start, int end)
+{
+    if (!rowKeysValid || parent.isValid())
+        return;
+
+    if (end >= rowKeys.size()) {
+        invalidateRowKeys();
+        return;
+    }
+
+    rowKeys.remove(start, end - start + 1);
+}
+
+void VCategorizedSortFilterProxyModel::Private::_k_sourceLayoutChanged()
+{
+    invalidateRowKeys();
+}
+
+void VCategorizedSortFilterProxyModel::Private::_k_layoutAboutToBeChanged()
+{
+    // QSortFilterProxyModel announces every sort, whichever setter
+    // started it, the settings are checked again on the next comparison
+    rowKeysChecked = false;
+}
+
 VCategorizedSortFilterProxyModel::VCategorizedSortFilterProxyModel(QObject *parent)
     : QSortFilterProxyModel(parent)
-    , d(new Private())
+    , d(new Private(this))
 {
+    connect(this, SIGNAL(layoutAboutToBeChanged()), this, SLOT(_k_layoutAboutToBeChanged()));
 }
 
 VCategorizedSortFilterProxyModel::~VCategorizedSortFilterProxyModel()
@@ -51,11 +389,65 @@ VCategorizedSortFilterProxyModel::~VCategorizedSortFilterProxyModel()
     delete d;
 }
 
+void VCategorizedSortFilterProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    if (sourceModel == this->sourceModel()) {
+        QSortFilterProxyModel::setSourceModel(sourceModel);
+        return;
+    }
+
+    if (this->sourceModel()) {
+        QAbstractItemModel *model = this->sourceModel();
+        disconnect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)),
+                   this, SLOT(_k_sourceDataChanged(QModelIndex, QModelIndex)));
+        disconnect(model, SIGNAL(rowsInserted(QModelIndex, int, int)),
+                   this, SLOT(_k_sourceRowsInserted(QModelIndex, int, int)));
+        disconnect(model, SIGNAL(rowsRemoved(QModelIndex, int, int)),
+                   this, SLOT(_k_sourceRowsRemoved(QModelIndex, int, int)));
+        disconnect(model, SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)),
+                   this, SLOT(_k_sourceLayoutChanged()));
+        disconnect(model, SIGNAL(columnsInserted(QModelIndex, int, int)),
+                   this, SLOT(_k_sourceLayoutChanged()));
+        disconnect(model, SIGNAL(columnsRemoved(QModelIndex, int, int)),
+                   this, SLOT(_k_sourceLayoutChanged()));
+        disconnect(model, SIGNAL(layoutChanged()), this, SLOT(_k_sourceLayoutChanged()));
+        disconnect(model, SIGNAL(modelReset()), this, SLOT(_k_sourceLayoutChanged()));
+    }
+
+    d->invalidateRowKeys();
+
+    // Connect before QSortFilterProxyModel does, so that keys are up
+    // to date by the time it sorts the changed rows again
+    if (sourceModel) {
+        connect(sourceModel, SIGNAL(dataChanged(QModelIndex, QModelIndex)),
+                this, SLOT(_k_sourceDataChanged(QModelIndex, QModelIndex)));
+        connect(sourceModel, SIGNAL(rowsInserted(QModelIndex, int, int)),
+                this, SLOT(_k_sourceRowsInserted(QModelIndex, int, int)));
+        connect(sourceModel, SIGNAL(rowsRemoved(QModelIndex, int, int)),
+                this, SLOT(_k_sourceRowsRemoved(QModelIndex, int, int)));
+        connect(sourceModel, SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)),
+                this, SLOT(_k_sourceLayoutChanged()));
+        connect(sourceModel, SIGNAL(columnsInserted(QModelIndex, int, int)),
+                this, SLOT(_k_sourceLayoutChanged()));
+        connect(sourceModel, SIGNAL(columnsRemoved(QModelIndex, int, int)),
+                this, SLOT(_k_sourceLayoutChanged()));
+        connect(sourceModel, SIGNAL(layoutChanged()), this, SLOT(_k_sourceLayoutChanged()));
+        connect(sourceModel, SIGNAL(modelReset()), this, SLOT(_k_sourceLayoutChanged()));
+    }
+
+    QSortFilterProxyModel::setSourceModel(sourceModel);
+}
+
 void VCategorizedSortFilterProxyModel::sort(int column, Qt::SortOrder order)
 {
     d->sortColumn = column;
     d->sortOrder = order;
 
+    // Drop keys of strings that might not be in the model anymore
+    // and read the rows again
+    d->clearSortKeys();
+    d->invalidateRowKeys();
+
     QSortFilterProxyModel::sort(column, order);
 }
 
@@ -101,8 +493,30 @@ bool VCategorizedSortFilterProxyModel::sortCategoriesByNaturalComparison() const
     return d->sortCategoriesByNaturalComparison;
 }
 
+void VCategorizedSortFilterProxyModel::setSortKeyCacheEnabled(bool enabled)
+{
+    if (enabled == d->sortKeyCacheEnabled) {
+        return;
+    }
+
+    d->sortKeyCacheEnabled = enabled;
+    d->clearSortKeys();
+
+    invalidate();
+}
+
+bool VCategorizedSortFilterProxyModel::isSortKeyCacheEnabled() const
+{
+    return d->sortKeyCacheEnabled;
+}
+
 bool VCategorizedSortFilterProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
 {
+    const Private::RowKeys *lkeys = d->keysFor(left);
+    const Private::RowKeys *rkeys = lkeys ? d->keysFor(right) : 0;
+    if (lkeys && rkeys && lkeys->rank >= 0 && rkeys->rank >= 0)
+        return lkeys->rank < rkeys->rank;
+
     if (d->categorizedModel) {
         int compare = compareCategories(left, right);
 
@@ -119,11 +533,32 @@ bool VCategorizedSortFilterProxyModel::lessThan(const QModelIndex &left, const Q
 
 bool VCategorizedSortFilterProxyModel::subSortLessThan(const QModelIndex &left, const QModelIndex &right) const
 {
+    const Private::RowKeys *lkeys = d->keysFor(left);
+    const Private::RowKeys *rkeys = lkeys ? d->keysFor(right) : 0;
+    if (lkeys && rkeys)
+        return d->sortKeyLessThan(*lkeys, *rkeys);
+
+    if (d->sortKeyCacheEnabled) {
+        QVariant l = left.data(sortRole());
+        QVariant r = right.data(sortRole());
+
+        if (l.type() == QVariant::String && r.type() == QVariant::String) {
+            Qt::CaseSensitivity cs = sortCaseSensitivity();
+            return VStringHandler::compareNaturalSortKeys(d->sortKey(l.toString(), cs),
+                                                          d->sortKey(r.toString(), cs)) < 0;
+        }
+    }
+
     return QSortFilterProxyModel::lessThan(left, right);
 }
 
 int VCategorizedSortFilterProxyModel::compareCategories(const QModelIndex &left, const QModelIndex &right) const
 {
+    const Private::RowKeys *lkeys = d->keysFor(left);
+    const Private::RowKeys *rkeys = lkeys ? d->keysFor(right) : 0;
+    if (lkeys && rkeys)
+        return d->compareCategoryKeys(*lkeys, *rkeys);
+
     QVariant l = (left.model() ? left.model()->data(left, CategorySortRole) : QVariant());
     QVariant r = (right.model() ? right.model()->data(right, CategorySortRole) : QVariant());
 
@@ -135,7 +570,10 @@ int VCategorizedSortFilterProxyModel::compareCategories(const QModelIndex &left,
         QString lstr = l.toString();
         QString rstr = r.toString();
 
-        if (d->sortCategoriesByNaturalComparison) {
+        if (d->sortCategoriesByNaturalComparison && d->sortKeyCacheEnabled) {
+            return VStringHandler::compareNaturalSortKeys(d->sortKey(lstr, Qt::CaseSensitive),
+                                                          d->sortKey(rstr, Qt::CaseSensitive));
+        } else if (d->sortCategoriesByNaturalComparison) {
             return VStringHandler::naturalCompare(lstr, rstr);
         } else {
             if (lstr < rstr) {
@@ -161,3 +599,5 @@ int VCategorizedSortFilterProxyModel::compareCategories(const QModelIndex &left,
 
     return 0;
 }
+
+#include "moc_vcategorizedsortfilterproxymodel.cpp"
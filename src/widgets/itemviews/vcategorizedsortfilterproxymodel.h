@@ -54,6 +54,7 @@ class QItemSelection;
   */
 class VIBEWIDGETS_EXPORT VCategorizedSortFilterProxyModel : public QSortFilterProxyModel
 {
+    Q_OBJECT
 public:
     enum AdditionalRoles {
         // Note: use printf "0x%08X\n" $(($RANDOM*$RANDOM))
@@ -71,9 +72,17 @@ public:
     explicit VCategorizedSortFilterProxyModel(QObject *parent = 0);
     virtual ~VCategorizedSortFilterProxyModel();
 
+    /**
+      * Overridden from QSortFilterProxyModel. Keeps track of the source
+      * model changes to update the cached sort keys.
+      */
+    virtual void setSourceModel(QAbstractItemModel *sourceModel);
+
     /**
       * Overridden from QSortFilterProxyModel. Sorts the source model using
       * @p column for the given @p order.
+      * Category and sort role values of the top level rows are extracted once
+      * per sort and kept up to date when the source model reports changes.
       */
     virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
 
@@ -113,6 +122,22 @@ public:
       */
     bool sortCategoriesByNaturalComparison() const;
 
+    /**
+      * Set whether natural sort keys are computed once per string and cached,
+      * instead of comparing strings with a natural comparison every time.
+      * When enabled, both the categories (if sortCategoriesByNaturalComparison()
+      * is true) and the items returning strings for sortRole() are sorted by
+      * VStringHandler::naturalSortKey(), which is much faster on large models.
+      * @note Keys don't depend on the locale, see VStringHandler::naturalSortKey().
+      * @param enabled whether to cache natural sort keys or not.
+      */
+    void setSortKeyCacheEnabled(bool enabled);
+
+    /**
+      * @return whether natural sort keys are cached. Disabled by default.
+      */
+    bool isSortKeyCacheEnabled() const;
+
 protected:
     /**
       * Overridden from QSortFilterProxyModel. If you are subclassing
@@ -145,7 +170,8 @@ protected:
       * @p right models for role CategorySortRole. In order to correctly sort
       * categories, the data() metod of the model should return a qlonglong (or numeric) value, or
       * a QString object. QString objects will be sorted with QString::localeAwareCompare if
-      * sortCategoriesByNaturalComparison() is true.
+      * sortCategoriesByNaturalComparison() is true. Values are read once per sort,
+      * not once per comparison.
       *
       * @note Please have present that:
       *       QString(QChar(QChar::ObjectReplacementCharacter)) >
@@ -177,6 +203,12 @@ protected:
 private:
     class Private;
     Private *const d;
+
+    Q_PRIVATE_SLOT(d, void _k_sourceDataChanged(QModelIndex, QModelIndex))
+    Q_PRIVATE_SLOT(d, void _k_sourceRowsInserted(QModelIndex, int, int))
+    Q_PRIVATE_SLOT(d, void _k_sourceRowsRemoved(QModelIndex, int, int))
+    Q_PRIVATE_SLOT(d, void _k_sourceLayoutChanged())
+    Q_PRIVATE_SLOT(d, void _k_layoutAboutToBeChanged())
 };
 
 
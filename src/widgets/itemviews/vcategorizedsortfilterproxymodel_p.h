@@ -43,25 +43,147 @@
 // We mean it.
 //
 
+#include <QHash>
+#include <QVariant>
+#include <QVector>
+
+#include <VibeCore/VStringHandler>
+
 class VCategorizedSortFilterProxyModel;
 
 class VCategorizedSortFilterProxyModel::Private
 {
 public:
-    Private()
-        : sortColumn(0)
+    /**
+      * Category and sort keys of a source row, extracted once so that
+      * comparisons don't have to call data() on the source model.
+      */
+    struct RowKeys {
+        RowKeys()
+            : categoryIsString(false)
+            , categoryValue(0)
+            , rank(-1)
+            , id(0) {
+        }
+
+        bool categoryIsString;
+        QString categoryString;
+        QByteArray categoryKey;
+        qlonglong categoryValue;
+        QVariant sortValue;
+        QByteArray sortKey;
+        int rank; ///< position among the sorted rows, -1 if unknown
+        quintptr id; ///< internal id of the row's index
+    };
+
+    /**
+      * Settings the row keys were extracted with, if any of them
+      * changes the keys are extracted again.
+      */
+    struct KeySettings {
+        KeySettings()
+            : column(-1)
+            , sortRole(Qt::DisplayRole)
+            , sortCaseSensitivity(Qt::CaseSensitive)
+            , sortLocaleAware(false)
+            , categorizedModel(false)
+            , sortCategoriesByNaturalComparison(false)
+            , sortKeyCacheEnabled(false) {
+        }
+
+        bool operator==(const KeySettings &other) const {
+            return column == other.column &&
+                   sortRole == other.sortRole &&
+                   sortCaseSensitivity == other.sortCaseSensitivity &&
+                   sortLocaleAware == other.sortLocaleAware &&
+                   categorizedModel == other.categorizedModel &&
+                   sortCategoriesByNaturalComparison == other.sortCategoriesByNaturalComparison &&
+                   sortKeyCacheEnabled == other.sortKeyCacheEnabled;
+        }
+
+        int column;
+        int sortRole;
+        Qt::CaseSensitivity sortCaseSensitivity;
+        bool sortLocaleAware;
+        bool categorizedModel;
+        bool sortCategoriesByNaturalComparison;
+        bool sortKeyCacheEnabled;
+    };
+
+    /**
+      * Compares source rows by their keys, safe to use from other threads.
+      */
+    struct RowLessThan {
+        RowLessThan(const Private *d)
+            : d(d) {
+        }
+
+        bool operator()(int left, int right) const;
+
+        const Private *d;
+    };
+
+    Private(VCategorizedSortFilterProxyModel *q)
+        : q(q)
+        , sortColumn(0)
         , sortOrder(Qt::AscendingOrder)
         , categorizedModel(false)
-        , sortCategoriesByNaturalComparison(true) {
+        , sortCategoriesByNaturalComparison(true)
+        , sortKeyCacheEnabled(false)
+        , rowKeysValid(false)
+        , rowKeysChecked(false) {
     }
 
     ~Private() {
     }
 
+    VCategorizedSortFilterProxyModel *q;
+
     int sortColumn;
     Qt::SortOrder sortOrder;
     bool categorizedModel;
     bool sortCategoriesByNaturalComparison;
+    bool sortKeyCacheEnabled;
+
+    // Natural sort keys by string and case sensitivity, strings usually
+    // repeat a lot (categories) and unlike rows they never go stale
+    mutable QHash<QString, QByteArray> sortKeys;
+    mutable QHash<QString, QByteArray> caseInsensitiveSortKeys;
+
+    // Keys of the top level source rows, indexed by row
+    mutable QVector<RowKeys> rowKeys;
+    mutable KeySettings rowKeySettings;
+    mutable bool rowKeysValid;
+    mutable bool rowKeysChecked; ///< settings compared since the last sort started
+
+    QByteArray sortKey(const QString &s, Qt::CaseSensitivity cs) const {
+        QHash<QString, QByteArray> &keys = cs == Qt::CaseSensitive ? sortKeys : caseInsensitiveSortKeys;
+        QHash<QString, QByteArray>::iterator it = keys.find(s);
+        if (it == keys.end())
+            it = keys.insert(s, VStringHandler::naturalSortKey(s, cs));
+        return it.value();
+    }
+
+    void clearSortKeys() {
+        sortKeys.clear();
+        caseInsensitiveSortKeys.clear();
+    }
+
+    KeySettings currentKeySettings(int column) const;
+    const RowKeys *keysFor(const QModelIndex &index) const;
+    void extractKeys(int row, RowKeys &keys) const;
+    void rankRows() const;
+    void invalidateRowKeys();
+
+    int compareCategoryKeys(const RowKeys &left, const RowKeys &right) const;
+    bool sortKeyLessThan(const RowKeys &left, const RowKeys &right) const;
+    bool rowLessThan(const RowKeys &left, const RowKeys &right) const;
+
+    void _k_sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void _k_sourceRowsInserted(const QModelIndex &parent, int start, int end);
+    void _k_sourceRowsRemoved(const QModelIndex &parent, int start, int end);
+    void _k_sourceLayoutChanged();
+    void _k_layoutAboutToBeChanged();
 };
 
 #endif // VCATEGORIZEDSORTFILTERPROXYMODEL_P_H
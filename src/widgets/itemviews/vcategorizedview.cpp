@@ -61,13 +61,13 @@ struct VCategorizedView::Private::Item {
 
 struct VCategorizedView::Private::Block {
     Block()
-        : topLeft(QPoint())
+        : id(-1)
         , height(-1)
+        , headerHeight(-1)
+        , position(-1)
         , firstIndex(QModelIndex())
         , quarantineStart(QModelIndex())
-        , items(QList<Item>())
-        , outOfQuarantine(false)
-        , alternate(false)
+        , items(QVector<Item>())
         , collapsed(false) {
     }
 
@@ -75,14 +75,13 @@ struct VCategorizedView::Private::Block {
         return firstIndex != rhs.firstIndex;
     }
 
-    static bool lessThan(const Block &left, const Block &right) {
-        Q_ASSERT(left.firstIndex.isValid());
-        Q_ASSERT(right.firstIndex.isValid());
-        return left.firstIndex.row() < right.firstIndex.row();
-    }
-
-    QPoint topLeft;
+    int id;
+    QString category;
     int height;
+    int headerHeight;
+    // position of the block in the view, the blocks above it determine its offset.
+    // Odd positions are drawn with an alternate color, if enabled
+    int position;
     QPersistentModelIndex firstIndex;
     // if we have n elements on this block, and we inserted an element at position i. The quarantine
     // will start at index (i, column, parent). This means that for all elements j where i <= j <= n, the
@@ -91,18 +90,84 @@ struct VCategorizedView::Private::Block {
     // that the whole block will have different offset, but items will keep the same relative position
     // in terms of their parent blocks.
     QPersistentModelIndex quarantineStart;
-    QList<Item> items;
+    QVector<Item> items;
 
-    // this affects the whole block, not items separately. items contain the topLeft point relative
-    // to the block. Because of insertions or removals a whole block can be moved, so the whole block
-    // will enter in quarantine, what is faster than moving all items in absolute terms.
-    bool outOfQuarantine;
-
-    // should we alternate its color ? is just a hint, could not be used
-    bool alternate;
     bool collapsed;
 };
 
+void VCategorizedView::Private::BlockOffsets::insert(int position, int value)
+{
+    values.insert(position, value);
+    rebuild();
+}
+
+void VCategorizedView::Private::BlockOffsets::remove(int position)
+{
+    values.remove(position);
+    rebuild();
+}
+
+void VCategorizedView::Private::BlockOffsets::setValue(int position, int value)
+{
+    const int delta = value - values.at(position);
+    if (!delta) {
+        return;
+    }
+
+    values[position] = value;
+    for (int i = position + 1; i < tree.count(); i += i & -i) {
+        tree[i] += delta;
+    }
+}
+
+void VCategorizedView::Private::BlockOffsets::clear()
+{
+    values.clear();
+    tree.clear();
+}
+
+int VCategorizedView::Private::BlockOffsets::offset(int position) const
+{
+    int res = 0;
+    for (int i = position; i > 0; i -= i & -i) {
+        res += tree.at(i);
+    }
+    return res;
+}
+
+int VCategorizedView::Private::BlockOffsets::positionAt(int offset) const
+{
+    const int count = values.count();
+
+    int step = 1;
+    while (step * 2 <= count) {
+        step *= 2;
+    }
+
+    int position = 0;
+    for (; step > 0; step /= 2) {
+        if (position + step <= count && tree.at(position + step) <= offset) {
+            position += step;
+            offset -= tree.at(position);
+        }
+    }
+
+    return qMin(position, count - 1);
+}
+
+void VCategorizedView::Private::BlockOffsets::rebuild()
+{
+    const int count = values.count();
+    tree.fill(0, count + 1);
+    for (int i = 1; i <= count; ++i) {
+        tree[i] += values.at(i - 1);
+        const int parent = i + (i & -i);
+        if (parent <= count) {
+            tree[parent] += tree.at(i);
+        }
+    }
+}
+
 VCategorizedView::Private::Private(VCategorizedView *q)
     : q(q)
     , proxyModel(0)
@@ -119,6 +184,7 @@ VCategorizedView::Private::Private(VCategorizedView *q)
 
 VCategorizedView::Private::~Private()
 {
+    clearBlocks();
     delete hoveredBlock;
 }
 
@@ -131,12 +197,16 @@ QStyleOptionViewItemV4 VCategorizedView::Private::blockRect(const QModelIndex &r
 {
     QStyleOptionViewItemV4 option(q->viewOptions());
     const int height = categoryDrawer->categoryHeight(representative, option);
-    const QString categoryDisplay = representative.data(VCategorizedSortFilterProxyModel::CategoryDisplayRole).toString();
-    QPoint pos = blockPosition(categoryDisplay);
+    Block *block = blockForRow(representative.row());
+    if (!block) {
+        option.rect = QRect();
+        return option;
+    }
+    QPoint pos = blockPosition(*block);
     pos.ry() -= height;
     option.rect.setTopLeft(pos);
     option.rect.setWidth(viewportWidth() + categoryDrawer->leftMargin() + categoryDrawer->rightMargin());
-    option.rect.setHeight(height + blockHeight(categoryDisplay));
+    option.rect.setHeight(height + blockHeight(*block));
     option.rect = mapToViewport(option.rect);
 
     return option;
@@ -195,41 +265,169 @@ QPair<QModelIndex, QModelIndex> VCategorizedView::Private::intersectingIndexesWi
     return qMakePair(bottomIndex, topIndex);
 }
 
-QPoint VCategorizedView::Private::blockPosition(const QString &category)
+QPoint VCategorizedView::Private::blockPosition(Block &block)
 {
-    Block &block = blocks[category];
+    if (block.headerHeight < 0) {
+        const QModelIndex categoryIndex = proxyModel->index(block.firstIndex.row(), proxyModel->sortColumn(), q->rootIndex());
+        block.headerHeight = categoryDrawer->categoryHeight(categoryIndex, q->viewOptions());
+    }
+
+    return QPoint(categorySpacing, blockOffset(block.position) + block.headerHeight + categorySpacing);
+}
 
-    if (block.outOfQuarantine && !block.topLeft.isNull()) {
-        return block.topLeft;
+int VCategorizedView::Private::blockOffset(int position)
+{
+    // Extents are computed top to bottom: the height of a block depends on
+    // its position, hence on the extents of the blocks above it
+    while (!dirtyBlocks.isEmpty() && dirtyBlocks.firstKey() < position) {
+        const int dirtyPosition = dirtyBlocks.firstKey();
+        dirtyBlocks.erase(dirtyBlocks.begin());
+        updateBlockExtent(dirtyPosition);
     }
 
-    QPoint res(categorySpacing, 0);
+    return blockOffsets.offset(qMax(position, 0));
+}
 
-    const QModelIndex index = block.firstIndex;
+VCategorizedView::Private::Block &VCategorizedView::Private::createBlock(const QString &category)
+{
+    Block *block = new Block();
+    block->category = category;
 
-    for (QHash<QString, Private::Block>::Iterator it = blocks.begin(); it != blocks.end(); ++it) {
-        Block &block = *it;
-        const QModelIndex categoryIndex = block.firstIndex;
-        if (index.row() < categoryIndex.row()) {
-            continue;
+    if (freeCategoryIds.isEmpty()) {
+        block->id = blocks.count();
+        blocks.append(block);
+    } else {
+        block->id = freeCategoryIds.takeLast();
+        blocks[block->id] = block;
+    }
+    categoryIds.insert(category, block->id);
+
+    return *block;
+}
+
+void VCategorizedView::Private::insertBlock(Block &block)
+{
+    const int row = block.firstIndex.row();
+
+    // binary search by first row, blocks don't overlap
+    int bottom = 0;
+    int top = blockOrder.count() - 1;
+    while (bottom <= top) {
+        const int middle = (bottom + top) / 2;
+        if (blockOrder.at(middle)->firstIndex.row() < row) {
+            bottom = middle + 1;
+        } else {
+            top = middle - 1;
         }
-        res.ry() += categoryDrawer->categoryHeight(categoryIndex, q->viewOptions()) + categorySpacing;
-        if (index.row() == categoryIndex.row()) {
-            continue;
+    }
+
+    blockOrder.insert(bottom, &block);
+    blockOffsets.insert(bottom, 0);
+    for (int i = bottom; i < blockOrder.count(); ++i) {
+        blockOrder.at(i)->position = i;
+    }
+
+    QMap<int, bool> dirty;
+    for (QMap<int, bool>::ConstIterator it = dirtyBlocks.constBegin(); it != dirtyBlocks.constEnd(); ++it) {
+        dirty.insert(it.key() < bottom ? it.key() : it.key() + 1, true);
+    }
+    dirty.insert(bottom, true);
+    dirtyBlocks = dirty;
+}
+
+void VCategorizedView::Private::removeBlock(Block *block)
+{
+    const int position = block->position;
+
+    categoryIds.remove(block->category);
+    blocks[block->id] = 0;
+    freeCategoryIds.append(block->id);
+    delete block;
+
+    if (position < 0 || position >= blockOrder.count()) {
+        return;
+    }
+
+    blockOrder.remove(position);
+    blockOffsets.remove(position);
+    for (int i = position; i < blockOrder.count(); ++i) {
+        blockOrder.at(i)->position = i;
+    }
+
+    QMap<int, bool> dirty;
+    for (QMap<int, bool>::ConstIterator it = dirtyBlocks.constBegin(); it != dirtyBlocks.constEnd(); ++it) {
+        if (it.key() != position) {
+            dirty.insert(it.key() < position ? it.key() : it.key() - 1, true);
         }
-        res.ry() += blockHeight(it.key());
     }
+    dirtyBlocks = dirty;
+}
 
-    block.outOfQuarantine = true;
-    block.topLeft = res;
+VCategorizedView::Private::Block *VCategorizedView::Private::blockForRow(int row) const
+{
+    // the last block starting at or before row
+    int bottom = 0;
+    int top = blockOrder.count() - 1;
+    while (bottom <= top) {
+        const int middle = (bottom + top) / 2;
+        if (blockOrder.at(middle)->firstIndex.row() <= row) {
+            bottom = middle + 1;
+        } else {
+            top = middle - 1;
+        }
+    }
 
-    return res;
+    if (top < 0) {
+        return 0;
+    }
+
+    Block *block = blockOrder.at(top);
+    if (row - block->firstIndex.row() >= block->items.count()) {
+        return 0;
+    }
+    return block;
+}
+
+VCategorizedView::Private::Block *VCategorizedView::Private::blockForCategory(const QString &category) const
+{
+    QHash<QString, int>::ConstIterator it = categoryIds.constFind(category);
+    if (it == categoryIds.constEnd()) {
+        return 0;
+    }
+    return blocks.at(it.value());
+}
+
+void VCategorizedView::Private::clearBlocks()
+{
+    qDeleteAll(blocks);
+    blocks.clear();
+    categoryIds.clear();
+    freeCategoryIds.clear();
+    blockOrder.clear();
+    blockOffsets.clear();
+    dirtyBlocks.clear();
 }
 
-int VCategorizedView::Private::blockHeight(const QString &category)
+void VCategorizedView::Private::invalidateBlock(Block &block)
 {
-    Block &block = blocks[category];
+    block.height = -1;
+    if (block.position >= 0) {
+        dirtyBlocks.insert(block.position, true);
+    }
+}
+
+void VCategorizedView::Private::updateBlockExtent(int position)
+{
+    Block &block = *blockOrder.at(position);
+
+    const QModelIndex categoryIndex = proxyModel->index(block.firstIndex.row(), proxyModel->sortColumn(), q->rootIndex());
+    block.headerHeight = categoryDrawer->categoryHeight(categoryIndex, q->viewOptions());
 
+    blockOffsets.setValue(position, block.headerHeight + categorySpacing + blockHeight(block));
+}
+
+int VCategorizedView::Private::blockHeight(Block &block)
+{
     if (block.collapsed) {
         return 0;
     }
@@ -240,6 +438,15 @@ int VCategorizedView::Private::blockHeight(const QString &category)
 
     const QModelIndex firstIndex = block.firstIndex;
     const QModelIndex lastIndex = proxyModel->index(firstIndex.row() + block.items.count() - 1, q->modelColumn(), q->rootIndex());
+
+    // Lay out the items in quarantine top to bottom, so that each one finds its
+    // predecessor already placed instead of recursing through the whole block
+    if (block.quarantineStart.isValid()) {
+        for (int row = block.quarantineStart.row(); row < lastIndex.row(); ++row) {
+            q->visualRect(proxyModel->index(row, q->modelColumn(), q->rootIndex()));
+        }
+    }
+
     const QRect topLeft = q->visualRect(firstIndex);
     QRect bottomRight = q->visualRect(lastIndex);
 
@@ -264,11 +471,10 @@ int VCategorizedView::Private::viewportWidth() const
 
 void VCategorizedView::Private::regenerateAllElements()
 {
-    for (QHash<QString, Block>::Iterator it = blocks.begin(); it != blocks.end(); ++it) {
-        Block &block = *it;
-        block.outOfQuarantine = false;
-        block.quarantineStart = block.firstIndex;
-        block.height = -1;
+    foreach (Block *block, blockOrder) {
+        block->quarantineStart = block->firstIndex;
+        block->headerHeight = -1;
+        invalidateBlock(*block);
     }
 }
 
@@ -278,14 +484,39 @@ void VCategorizedView::Private::rowsInserted(const QModelIndex &parent, int star
         return;
     }
 
-    for (int i = start; i <= end; ++i) {
-        const QModelIndex index = proxyModel->index(i, q->modelColumn(), parent);
+    // The proxy keeps the rows of a category together, so the inserted rows come in runs
+    // that are found with an exponential search: a few categoryForIndex() calls per run
+    // instead of one per row.
+    int first = start;
+    while (first <= end) {
+        const QModelIndex index = proxyModel->index(first, q->modelColumn(), parent);
 
         Q_ASSERT(index.isValid());
 
         const QString category = categoryForIndex(index);
 
-        Block &block = blocks[category];
+        int last = first;
+        int next = end + 1;
+        for (int step = 1; last + step < next; step *= 2) {
+            const QModelIndex probe = proxyModel->index(last + step, q->modelColumn(), parent);
+            if (categoryForIndex(probe) != category) {
+                next = last + step;
+                break;
+            }
+            last += step;
+        }
+        while (next - last > 1) {
+            const int middle = (last + next) / 2;
+            const QModelIndex probe = proxyModel->index(middle, q->modelColumn(), parent);
+            if (categoryForIndex(probe) == category) {
+                last = middle;
+            } else {
+                next = middle;
+            }
+        }
+
+        Block *existing = blockForCategory(category);
+        Block &block = existing ? *existing : createBlock(category);
 
         //BEGIN: update firstIndex
         // save as firstIndex in block if
@@ -299,48 +530,24 @@ void VCategorizedView::Private::rowsInserted(const QModelIndex &parent, int star
 
         Q_ASSERT(block.firstIndex.isValid());
 
-        const int firstIndexRow = block.firstIndex.row();
+        if (block.position < 0) {
+            insertBlock(block);
+        }
 
-        block.items.insert(index.row() - firstIndexRow, Private::Item());
-        block.height = -1;
+        block.items.insert(index.row() - block.firstIndex.row(), last - first + 1, Private::Item());
 
-        q->visualRect(index);
-        q->viewport()->update();
-    }
+        // geometry is computed on the next layout pass, from the first inserted row on
+        if (!block.quarantineStart.isValid() || index.row() < block.quarantineStart.row()) {
+            block.quarantineStart = index;
+        }
+        invalidateBlock(block);
 
-    //BEGIN: update the items that are in quarantine in affected categories
-    {
-        const QModelIndex lastIndex = proxyModel->index(end, q->modelColumn(), parent);
-        const QString category = categoryForIndex(lastIndex);
-        Private::Block &block = blocks[category];
-        block.quarantineStart = block.firstIndex;
+        first = last + 1;
     }
-    //END: update the items that are in quarantine in affected categories
 
-    //BEGIN: mark as in quarantine those categories that are under the affected ones
-    {
-        const QModelIndex firstIndex = proxyModel->index(start, q->modelColumn(), parent);
-        const QString category = categoryForIndex(firstIndex);
-        const QModelIndex firstAffectedCategory = blocks[category].firstIndex;
-        //BEGIN: order for marking as alternate those blocks that are alternate
-        QList<Block> blockList = blocks.values();
-        qSort(blockList.begin(), blockList.end(), Block::lessThan);
-        QList<int> firstIndexesRows;
-        foreach(const Block & block, blockList) {
-            firstIndexesRows << block.firstIndex.row();
-        }
-        //END: order for marking as alternate those blocks that are alternate
-        for (QHash<QString, Private::Block>::Iterator it = blocks.begin(); it != blocks.end(); ++it) {
-            Private::Block &block = *it;
-            if (block.firstIndex.row() > firstAffectedCategory.row()) {
-                block.outOfQuarantine = false;
-                block.alternate = firstIndexesRows.indexOf(block.firstIndex.row()) % 2;
-            } else if (block.firstIndex.row() == firstAffectedCategory.row()) {
-                block.alternate = firstIndexesRows.indexOf(block.firstIndex.row()) % 2;
-            }
-        }
-    }
-    //END: mark as in quarantine those categories that are under the affected ones
+    // the blocks under the affected ones are moved by the offsets, and their
+    // alternate color is given by their position
+    q->viewport()->update();
 }
 
 QRect VCategorizedView::Private::mapToViewport(const QRect &rect) const
@@ -526,7 +733,7 @@ void VCategorizedView::setModel(QAbstractItemModel *model)
         return;
     }
 
-    d->blocks.clear();
+    d->clearBlocks();
 
     if (d->proxyModel) {
         disconnect(d->proxyModel, SIGNAL(layoutChanged()), this, SLOT(slotLayoutChanged()));
@@ -567,13 +774,13 @@ QRect VCategorizedView::visualRect(const QModelIndex &index) const
         return QRect();
     }
 
-    const QString category = d->categoryForIndex(index);
+    Private::Block *blockForIndex = d->blockForRow(index.row());
 
-    if (!d->blocks.contains(category)) {
+    if (!blockForIndex) {
         return QRect();
     }
 
-    Private::Block &block = d->blocks[category];
+    Private::Block &block = *blockForIndex;
     const int firstIndexRow = block.firstIndex.row();
 
     Q_ASSERT(block.firstIndex.isValid());
@@ -582,7 +789,7 @@ QRect VCategorizedView::visualRect(const QModelIndex &index) const
         return QRect();
     }
 
-    const QPoint blockPos = d->blockPosition(category);
+    const QPoint blockPos = d->blockPosition(block);
 
     Private::Item &ritem = block.items[index.row() - firstIndexRow];
 
@@ -669,9 +876,9 @@ void VCategorizedView::setCategorySpacing(int categorySpacing)
 
     d->categorySpacing = categorySpacing;
 
-    for (QHash<QString, Private::Block>::Iterator it = d->blocks.begin(); it != d->blocks.end(); ++it) {
-        Private::Block &block = *it;
-        block.outOfQuarantine = false;
+    // the spacing is part of the extent of every block
+    for (int i = 0; i < d->blockOrder.count(); ++i) {
+        d->dirtyBlocks.insert(i, true);
     }
 }
 
@@ -698,7 +905,11 @@ void VCategorizedView::setCollapsibleBlocks(bool enable)
 QModelIndexList VCategorizedView::block(const QString &category)
 {
     QModelIndexList res;
-    const Private::Block &block = d->blocks[category];
+    const Private::Block *categoryBlock = d->blockForCategory(category);
+    if (!categoryBlock) {
+        return res;
+    }
+    const Private::Block &block = *categoryBlock;
     if (block.height == -1) {
         return res;
     }
@@ -715,7 +926,11 @@ QModelIndexList VCategorizedView::block(const QString &category)
 
 QModelIndexList VCategorizedView::block(const QModelIndex &representative)
 {
-    return block(representative.data(VCategorizedSortFilterProxyModel::CategoryDisplayRole).toString());
+    const Private::Block *representativeBlock = d->blockForRow(representative.row());
+    if (!representativeBlock) {
+        return QModelIndexList();
+    }
+    return block(representativeBlock->category);
 }
 
 QModelIndex VCategorizedView::indexAt(const QPoint &point) const
@@ -769,7 +984,7 @@ QModelIndex VCategorizedView::indexAt(const QPoint &point) const
 
 void VCategorizedView::reset()
 {
-    d->blocks.clear();
+    d->clearBlocks();
     QListView::reset();
 }
 
@@ -780,7 +995,8 @@ void VCategorizedView::paintEvent(QPaintEvent *event)
         return;
     }
 
-    const QPair<QModelIndex, QModelIndex> intersecting = d->intersectingIndexesWithRect(viewport()->rect().intersected(event->rect()));
+    const QRect visibleRect = viewport()->rect().intersected(event->rect());
+    const QPair<QModelIndex, QModelIndex> intersecting = d->intersectingIndexesWithRect(visibleRect);
 
     QPainter p(viewport());
     p.save();
@@ -788,28 +1004,31 @@ void VCategorizedView::paintEvent(QPaintEvent *event)
     Q_ASSERT(selectionModel()->model() == d->proxyModel);
 
     //BEGIN: draw categories
-    QHash<QString, Private::Block>::ConstIterator it(d->blocks.constBegin());
-    while (it != d->blocks.constEnd()) {
-        const Private::Block &block = *it;
+    // compute the pending extents, then only visit the blocks that intersect the visible area
+    d->blockOffset(d->blockOrder.count());
+    const int visibleTop = verticalOffset() + visibleRect.top();
+    const int visibleBottom = verticalOffset() + visibleRect.bottom();
+    for (int position = qMax(d->blockOffsets.positionAt(visibleTop), 0);
+         position < d->blockOrder.count() && d->blockOffsets.offset(position) <= visibleBottom;
+         ++position) {
+        Private::Block &block = *d->blockOrder.at(position);
         const QModelIndex categoryIndex = d->proxyModel->index(block.firstIndex.row(), d->proxyModel->sortColumn(), rootIndex());
         QStyleOptionViewItemV4 option(viewOptions());
-        option.features |= d->alternatingBlockColors && block.alternate ? QStyleOptionViewItemV4::Alternate
+        option.features |= d->alternatingBlockColors && (block.position % 2) ? QStyleOptionViewItemV4::Alternate
                            : QStyleOptionViewItemV4::None;
         option.state |= !d->collapsibleBlocks || !block.collapsed ? QStyle::State_Open
                         : QStyle::State_None;
         const int height = d->categoryDrawer->categoryHeight(categoryIndex, option);
-        QPoint pos = d->blockPosition(it.key());
+        QPoint pos = d->blockPosition(block);
         pos.ry() -= height;
         option.rect.setTopLeft(pos);
         option.rect.setWidth(d->viewportWidth() + d->categoryDrawer->leftMargin() + d->categoryDrawer->rightMargin());
-        option.rect.setHeight(height + d->blockHeight(it.key()));
+        option.rect.setHeight(height + d->blockHeight(block));
         option.rect = d->mapToViewport(option.rect);
         if (!option.rect.intersects(viewport()->rect())) {
-            ++it;
             continue;
         }
         d->categoryDrawer->drawCategory(categoryIndex, d->proxyModel->sortRole(), option, &p);
-        ++it;
     }
     //END: draw categories
 
@@ -817,15 +1036,14 @@ void VCategorizedView::paintEvent(QPaintEvent *event)
         //BEGIN: draw items
         int i = intersecting.first.row();
         int indexToCheckIfBlockCollapsed = i;
-        QModelIndex categoryIndex;
-        QString category;
         Private::Block *block = 0;
         while (i <= intersecting.second.row()) {
             //BEGIN: first check if the block is collapsed. if so, we have to skip the item painting
             if (i == indexToCheckIfBlockCollapsed) {
-                categoryIndex = d->proxyModel->index(i, d->proxyModel->sortColumn(), rootIndex());
-                category = categoryIndex.data(VCategorizedSortFilterProxyModel::CategoryDisplayRole).toString();
-                block = &d->blocks[category];
+                block = d->blockForRow(i);
+                if (!block) {
+                    break;
+                }
                 indexToCheckIfBlockCollapsed = block->firstIndex.row() + block->items.count();
                 if (block->collapsed) {
                     i = indexToCheckIfBlockCollapsed;
@@ -946,17 +1164,16 @@ void VCategorizedView::mouseMoveEvent(QMouseEvent *event)
         update(rect.united(d->rubberBandRect));
         d->rubberBandRect = rect;
     }
-    QHash<QString, Private::Block>::ConstIterator it(d->blocks.constBegin());
-    while (it != d->blocks.constEnd()) {
-        const Private::Block &block = *it;
+    for (int position = 0; position < d->blockOrder.count(); ++position) {
+        Private::Block &block = *d->blockOrder.at(position);
         const QModelIndex categoryIndex = d->proxyModel->index(block.firstIndex.row(), d->proxyModel->sortColumn(), rootIndex());
         QStyleOptionViewItemV4 option(viewOptions());
         const int height = d->categoryDrawer->categoryHeight(categoryIndex, option);
-        QPoint pos = d->blockPosition(it.key());
+        QPoint pos = d->blockPosition(block);
         pos.ry() -= height;
         option.rect.setTopLeft(pos);
         option.rect.setWidth(d->viewportWidth() + d->categoryDrawer->leftMargin() + d->categoryDrawer->rightMargin());
-        option.rect.setHeight(height + d->blockHeight(it.key()));
+        option.rect.setHeight(height + d->blockHeight(block));
         option.rect = d->mapToViewport(option.rect);
         const QPoint mousePos = viewport()->mapFromGlobal(QCursor::pos());
         if (option.rect.contains(mousePos)) {
@@ -965,18 +1182,17 @@ void VCategorizedView::mouseMoveEvent(QMouseEvent *event)
                 const QStyleOptionViewItemV4 option = d->blockRect(categoryIndex);
                 d->categoryDrawer->mouseLeft(categoryIndex, option.rect);
                 *d->hoveredBlock = block;
-                d->hoveredCategory = it.key();
+                d->hoveredCategory = block.category;
                 viewport()->update(option.rect);
             } else if (d->hoveredBlock->height == -1) {
                 *d->hoveredBlock = block;
-                d->hoveredCategory = it.key();
+                d->hoveredCategory = block.category;
             } else if (d->categoryDrawer) {
                 d->categoryDrawer->mouseMoved(categoryIndex, option.rect, event);
             }
             viewport()->update(option.rect);
             return;
         }
-        ++it;
     }
     if (d->categoryDrawer && d->hoveredBlock->height != -1) {
         const QModelIndex categoryIndex = d->proxyModel->index(d->hoveredBlock->firstIndex.row(), d->proxyModel->sortColumn(), rootIndex());
@@ -999,9 +1215,8 @@ void VCategorizedView::mousePressEvent(QMouseEvent *event)
         QListView::mousePressEvent(event);
         return;
     }
-    QHash<QString, Private::Block>::ConstIterator it(d->blocks.constBegin());
-    while (it != d->blocks.constEnd()) {
-        const Private::Block &block = *it;
+    for (int position = 0; position < d->blockOrder.count(); ++position) {
+        Private::Block &block = *d->blockOrder.at(position);
         const QModelIndex categoryIndex = d->proxyModel->index(block.firstIndex.row(), d->proxyModel->sortColumn(), rootIndex());
         const QStyleOptionViewItemV4 option = d->blockRect(categoryIndex);
         const QPoint mousePos = viewport()->mapFromGlobal(QCursor::pos());
@@ -1014,7 +1229,6 @@ void VCategorizedView::mousePressEvent(QMouseEvent *event)
             }
             return;
         }
-        ++it;
     }
     QListView::mousePressEvent(event);
 }
@@ -1027,9 +1241,8 @@ void VCategorizedView::mouseReleaseEvent(QMouseEvent *event)
         QListView::mouseReleaseEvent(event);
         return;
     }
-    QHash<QString, Private::Block>::ConstIterator it(d->blocks.constBegin());
-    while (it != d->blocks.constEnd()) {
-        const Private::Block &block = *it;
+    for (int position = 0; position < d->blockOrder.count(); ++position) {
+        Private::Block &block = *d->blockOrder.at(position);
         const QModelIndex categoryIndex = d->proxyModel->index(block.firstIndex.row(), d->proxyModel->sortColumn(), rootIndex());
         const QStyleOptionViewItemV4 option = d->blockRect(categoryIndex);
         const QPoint mousePos = viewport()->mapFromGlobal(QCursor::pos());
@@ -1042,7 +1255,6 @@ void VCategorizedView::mouseReleaseEvent(QMouseEvent *event)
             }
             return;
         }
-        ++it;
     }
     QListView::mouseReleaseEvent(event);
 }
@@ -1139,7 +1351,7 @@ QModelIndex VCategorizedView::moveCursor(CursorAction cursorAction,
                 const QModelIndex current = currentIndex();
                 const QSize itemSize = d->hasGrid() ? gridSize()
                                        : sizeHintForIndex(current);
-                const Private::Block &block = d->blocks[d->categoryForIndex(current)];
+                const Private::Block &block = *d->blockForRow(current.row());
                 const int maxItemsPerRow = qMax(d->viewportWidth() / itemSize.width(), 1);
                 const bool canMove = current.row() + maxItemsPerRow < block.firstIndex.row() +
                                      block.items.count();
@@ -1155,7 +1367,7 @@ QModelIndex VCategorizedView::moveCursor(CursorAction cursorAction,
                     return QModelIndex();
                 }
 
-                const Private::Block &nextBlock = d->blocks[d->categoryForIndex(nextIndex)];
+                const Private::Block &nextBlock = *d->blockForRow(nextIndex.row());
 
                 if (nextBlock.items.count() <= currentRelativePos) {
                     return QModelIndex();
@@ -1173,7 +1385,7 @@ QModelIndex VCategorizedView::moveCursor(CursorAction cursorAction,
                 const QModelIndex current = currentIndex();
                 const QSize itemSize = d->hasGrid() ? gridSize()
                                        : sizeHintForIndex(current);
-                const Private::Block &block = d->blocks[d->categoryForIndex(current)];
+                const Private::Block &block = *d->blockForRow(current.row());
                 const int maxItemsPerRow = qMax(d->viewportWidth() / itemSize.width(), 1);
                 const bool canMove = current.row() - maxItemsPerRow >= block.firstIndex.row();
 
@@ -1188,7 +1400,7 @@ QModelIndex VCategorizedView::moveCursor(CursorAction cursorAction,
                     return QModelIndex();
                 }
 
-                const Private::Block &prevBlock = d->blocks[d->categoryForIndex(prevIndex)];
+                const Private::Block &prevBlock = *d->blockForRow(prevIndex.row());
 
                 if (prevBlock.items.count() <= currentRelativePos) {
                     return QModelIndex();
@@ -1222,7 +1434,7 @@ void VCategorizedView::rowsAboutToBeRemoved(const QModelIndex &parent,
     d->hoveredCategory = QString();
 
     if (end - start + 1 == d->proxyModel->rowCount()) {
-        d->blocks.clear();
+        d->clearBlocks();
         QListView::rowsAboutToBeRemoved(parent, start, end);
         return;
     }
@@ -1261,7 +1473,7 @@ void VCategorizedView::rowsAboutToBeRemoved(const QModelIndex &parent,
     // Also note that removal implicitly means that we have to update correctly firstIndex of each
     // block, and in general keep updated the internal information of elements.
 
-    QStringList listOfCategoriesMarkedForRemoval;
+    QList<Private::Block *> blocksMarkedForRemoval;
 
     QString lastCategory;
     int alreadyRemoved = 0;
@@ -1277,15 +1489,16 @@ void VCategorizedView::rowsAboutToBeRemoved(const QModelIndex &parent,
             alreadyRemoved = 0;
         }
 
-        Private::Block &block = d->blocks[category];
-        block.items.removeAt(i - block.firstIndex.row() - alreadyRemoved);
+        // rows are looked up by category, the blocks are shrinking while iterating
+        Private::Block &block = *d->blockForCategory(category);
+        block.items.remove(i - block.firstIndex.row() - alreadyRemoved);
         ++alreadyRemoved;
 
         if (!block.items.count()) {
-            listOfCategoriesMarkedForRemoval << category;
+            blocksMarkedForRemoval << &block;
         }
 
-        block.height = -1;
+        d->invalidateBlock(block);
 
         viewport()->update();
     }
@@ -1293,8 +1506,7 @@ void VCategorizedView::rowsAboutToBeRemoved(const QModelIndex &parent,
     //BEGIN: update the items that are in quarantine in affected categories
     {
         const QModelIndex lastIndex = d->proxyModel->index(end, modelColumn(), parent);
-        const QString category = d->categoryForIndex(lastIndex);
-        Private::Block &block = d->blocks[category];
+        Private::Block &block = *d->blockForCategory(d->categoryForIndex(lastIndex));
         if (block.items.count() && start <= block.firstIndex.row() && end >= block.firstIndex.row()) {
             block.firstIndex = d->proxyModel->index(end + 1, modelColumn(), parent);
         }
@@ -1302,32 +1514,12 @@ void VCategorizedView::rowsAboutToBeRemoved(const QModelIndex &parent,
     }
     //END: update the items that are in quarantine in affected categories
 
-    Q_FOREACH(const QString & category, listOfCategoriesMarkedForRemoval) {
-        d->blocks.remove(category);
+    // the blocks under the affected ones are moved by the offsets, and their
+    // alternate color is given by their position
+    Q_FOREACH(Private::Block * block, blocksMarkedForRemoval) {
+        d->removeBlock(block);
     }
 
-    //BEGIN: mark as in quarantine those categories that are under the affected ones
-    {
-        //BEGIN: order for marking as alternate those blocks that are alternate
-        QList<Private::Block> blockList = d->blocks.values();
-        qSort(blockList.begin(), blockList.end(), Private::Block::lessThan);
-        QList<int> firstIndexesRows;
-        foreach(const Private::Block & block, blockList) {
-            firstIndexesRows << block.firstIndex.row();
-        }
-        //END: order for marking as alternate those blocks that are alternate
-        for (QHash<QString, Private::Block>::Iterator it = d->blocks.begin(); it != d->blocks.end(); ++it) {
-            Private::Block &block = *it;
-            if (block.firstIndex.row() > start) {
-                block.outOfQuarantine = false;
-                block.alternate = firstIndexesRows.indexOf(block.firstIndex.row()) % 2;
-            } else if (block.firstIndex.row() == start) {
-                block.alternate = firstIndexesRows.indexOf(block.firstIndex.row()) % 2;
-            }
-        }
-    }
-    //END: mark as in quarantine those categories that are under the affected ones
-
     QListView::rowsAboutToBeRemoved(parent, start, end);
 }
 
@@ -1385,8 +1577,10 @@ void VCategorizedView::updateGeometries()
             lastItemRect.setSize(itemSize);
         } else {
             QSize itemSize = sizeHintForIndex(lastIndex);
-            const QString category = d->categoryForIndex(lastIndex);
-            itemSize.setHeight(d->highestElementInLastRow(d->blocks[category]) + spacing());
+            const Private::Block *lastBlock = d->blockForRow(lastIndex.row());
+            if (lastBlock) {
+                itemSize.setHeight(d->highestElementInLastRow(*lastBlock) + spacing());
+            }
             lastItemRect.setSize(itemSize);
         }
     }
@@ -1442,15 +1636,14 @@ void VCategorizedView::dataChanged(const QModelIndex &topLeft,
     //BEGIN: since the model changed data, we need to reconsider item sizes
     int i = topLeft.row();
     int indexToCheck = i;
-    QModelIndex categoryIndex;
-    QString category;
     Private::Block *block;
     while (i <= bottomRight.row()) {
         const QModelIndex currIndex = d->proxyModel->index(i, modelColumn(), rootIndex());
         if (i == indexToCheck) {
-            categoryIndex = d->proxyModel->index(i, d->proxyModel->sortColumn(), rootIndex());
-            category = categoryIndex.data(VCategorizedSortFilterProxyModel::CategoryDisplayRole).toString();
-            block = &d->blocks[category];
+            block = d->blockForRow(i);
+            if (!block) {
+                break;
+            }
             block->quarantineStart = currIndex;
             indexToCheck = block->firstIndex.row() + block->items.count();
         }
@@ -1478,7 +1671,7 @@ void VCategorizedView::slotLayoutChanged()
     if (!d->isCategorized())
         return;
 
-    d->blocks.clear();
+    d->clearBlocks();
     *d->hoveredBlock = Private::Block();
     d->hoveredCategory = QString();
     if (d->proxyModel->rowCount())
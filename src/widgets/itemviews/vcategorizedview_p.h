@@ -41,6 +41,9 @@
 // We mean it.
 //
 
+#include <QMap>
+#include <QVector>
+
 class VCategorizedSortFilterProxyModel;
 class VCategoryDrawer;
 
@@ -53,6 +56,47 @@ public:
     struct Block;
     struct Item;
 
+    /**
+      * Fenwick tree over the vertical extent of each block, indexed by the
+      * position of the block in the view. The offset of a block is the sum
+      * of the extents of the blocks above it.
+      *
+      * Complexity: O(log(n)) to change an extent or to query an offset, O(n) to
+      * insert or remove a block, where n is the number of blocks.
+      */
+    class BlockOffsets
+    {
+    public:
+        int count() const {
+            return values.count();
+        }
+
+        int value(int position) const {
+            return values.at(position);
+        }
+
+        void insert(int position, int value);
+        void remove(int position);
+        void setValue(int position, int value);
+        void clear();
+
+        /**
+          * @return the sum of the extents of the blocks before @p position.
+          */
+        int offset(int position) const;
+
+        /**
+          * @return the last position whose offset is not greater than @p offset.
+          */
+        int positionAt(int offset) const;
+
+    private:
+        QVector<int> values;
+        QVector<int> tree;
+
+        void rebuild();
+    };
+
     Private(VCategorizedView *q);
     ~Private();
 
@@ -77,17 +121,71 @@ public:
     QPair<QModelIndex, QModelIndex> intersectingIndexesWithRect(const QRect &rect) const;
 
     /**
-      * Returns the position of the block of @p category.
+      * Returns the position of @p block.
+      *
+      * Complexity: O(log(n)) where n is the number of different categories, plus the blocks
+      *             above it whose height has to be computed again.
+      */
+    QPoint blockPosition(Block &block);
+
+    /**
+      * Returns the sum of the extents of the blocks before @p position, after computing
+      * again the extents that were invalidated.
+      */
+    int blockOffset(int position);
+
+    /**
+      * Creates the block of @p category, interning the category to an id.
+      */
+    Block &createBlock(const QString &category);
+
+    /**
+      * Adds @p block, whose firstIndex must be already set, to the ordered blocks.
+      *
+      * Complexity: O(n) where n is the number of different categories.
+      */
+    void insertBlock(Block &block);
+
+    /**
+      * Removes and deletes @p block.
+      *
+      * Complexity: O(n) where n is the number of different categories.
+      */
+    void removeBlock(Block *block);
+
+    /**
+      * Returns the block that contains @p row, 0 if there is none.
+      *
+      * Complexity: O(log(n)) where n is the number of different categories.
+      */
+    Block *blockForRow(int row) const;
+
+    /**
+      * Returns the block of @p category, 0 if there is none.
+      */
+    Block *blockForCategory(const QString &category) const;
+
+    /**
+      * Removes all the blocks.
+      */
+    void clearBlocks();
+
+    /**
+      * Forgets the height of @p block, it will be computed again when needed.
       *
-      * Complexity: O(n) where n is the number of different categories when the block has been
-      *             marked as in quarantine. O(1) the rest of the times (the vast majority).
+      * Complexity: O(log(n)) where n is the number of different categories.
       */
-    QPoint blockPosition(const QString &category);
+    void invalidateBlock(Block &block);
 
     /**
-      * Returns the height of the block determined by @p category.
+      * Computes again the extent of the block at @p position.
       */
-    int blockHeight(const QString &category);
+    void updateBlockExtent(int position);
+
+    /**
+      * Returns the height of @p block.
+      */
+    int blockHeight(Block &block);
 
     /**
       * Returns the actual viewport width.
@@ -105,6 +203,8 @@ public:
 
     /**
       * Update internal information, and keep sync with the real information that the model contains.
+      *
+      * Complexity: O(n) where n is the number of inserted rows, positions are not computed.
       */
     void rowsInserted(const QModelIndex &parent, int start, int end);
 
@@ -169,7 +269,16 @@ public:
     QPoint pressedPosition;
     QRect rubberBandRect;
 
-    QHash<QString, Block> blocks;
+    // Blocks by category id, categories are interned to dense ids
+    QHash<QString, int> categoryIds;
+    QVector<Block *> blocks;
+    QVector<int> freeCategoryIds;
+
+    // Blocks in the order they are shown, extents of the blocks
+    // and positions of the blocks whose extent has to be computed again
+    QVector<Block *> blockOrder;
+    BlockOffsets blockOffsets;
+    QMap<int, bool> dirtyBlocks;
 };
 
 #endif // VCATEGORIZEDVIEW_P_H
@@ -30,6 +30,8 @@
 #include <QPainter>
 #include <QStyleOption>
 #include <QApplication>
+#include <QCache>
+#include <QPixmap>
 
 #include "vcategorydrawer.h"
 #include "vcategorizedview.h"
@@ -37,50 +39,66 @@
 
 #define HORIZONTAL_HINT 3
 
+// Rendered headers are kept up to this cost, in kilobytes
+#define PIXMAP_CACHE_SIZE 4096
+
 class VCategoryDrawer::Private
 {
 public:
     Private(VCategorizedView *view)
         : view(view)
         , leftMargin(0)
-        , rightMargin(0) {
+        , rightMargin(0)
+        , font(boldFont())
+        , fontMetrics(font)
+        , pixmapCache(PIXMAP_CACHE_SIZE) {
     }
 
     ~Private() {
     }
 
+    static QFont boldFont();
+
+    /**
+      * Drops the rendered headers and computes the font again, called when
+      * the style, the palette or the font of the view change.
+      */
+    void invalidate();
+
+    void paintHeader(QPainter *painter, const QRect &optRect,
+                     const QPalette &palette, const QString &category) const;
+
     VCategorizedView *view;
     int leftMargin;
     int rightMargin;
+
+    QFont font;
+    QFontMetrics fontMetrics;
+
+    // Least recently used headers are evicted first
+    QCache<QString, QPixmap> pixmapCache;
 };
 
-VCategoryDrawer::VCategoryDrawer(VCategorizedView *view)
-    : QObject(view)
-    , d(new Private(view))
+QFont VCategoryDrawer::Private::boldFont()
 {
-    setLeftMargin(2);
-    setRightMargin(2);
+    QFont font(QApplication::font());
+    font.setBold(true);
+    return font;
 }
 
-VCategoryDrawer::~VCategoryDrawer()
+void VCategoryDrawer::Private::invalidate()
 {
-    delete d;
+    font = boldFont();
+    fontMetrics = QFontMetrics(font);
+    pixmapCache.clear();
 }
 
-void VCategoryDrawer::drawCategory(const QModelIndex &index,
-                                   int /*sortRole*/,
-                                   const QStyleOption &option,
-                                   QPainter *painter) const
+void VCategoryDrawer::Private::paintHeader(QPainter *painter, const QRect &optRect,
+                                           const QPalette &palette, const QString &category) const
 {
     painter->setRenderHint(QPainter::Antialiasing);
 
-    const QString category = index.model()->data(index, VCategorizedSortFilterProxyModel::CategoryDisplayRole).toString();
-    const QRect optRect = option.rect;
-    QFont font(QApplication::font());
-    font.setBold(true);
-    const QFontMetrics fontMetrics = QFontMetrics(font);
-
-    QColor outlineColor = option.palette.text().color();
+    QColor outlineColor = palette.text().color();
     outlineColor.setAlphaF(0.35);
 
     //BEGIN: top left corner
@@ -112,8 +130,6 @@ void VCategoryDrawer::drawCategory(const QModelIndex &index,
     {
         QPoint start(optRect.topLeft());
         start.rx() += 3;
-        QPoint horizontalGradTop(optRect.topLeft());
-        horizontalGradTop.rx() += optRect.width() - 6;
         painter->fillRect(QRect(start, QSize(optRect.width() - 6, 1)), outlineColor);
     }
     //END: horizontal line
@@ -146,7 +162,7 @@ void VCategoryDrawer::drawCategory(const QModelIndex &index,
 
     //BEGIN: text
     {
-        QRect textRect(option.rect);
+        QRect textRect(optRect);
         textRect.setTop(textRect.top() + 7);
         textRect.setLeft(textRect.left() + 7);
         textRect.setHeight(fontMetrics.height());
@@ -154,7 +170,7 @@ void VCategoryDrawer::drawCategory(const QModelIndex &index,
 
         painter->save();
         painter->setFont(font);
-        QColor penColor(option.palette.text().color());
+        QColor penColor(palette.text().color());
         penColor.setAlphaF(0.6);
         painter->setPen(penColor);
         painter->drawText(textRect, Qt::AlignLeft | Qt::AlignVCenter, category);
@@ -163,16 +179,71 @@ void VCategoryDrawer::drawCategory(const QModelIndex &index,
     //END: text
 }
 
+VCategoryDrawer::VCategoryDrawer(VCategorizedView *view)
+    : QObject(view)
+    , d(new Private(view))
+{
+    setLeftMargin(2);
+    setRightMargin(2);
+
+    if (view) {
+        view->installEventFilter(this);
+    }
+}
+
+VCategoryDrawer::~VCategoryDrawer()
+{
+    delete d;
+}
+
+void VCategoryDrawer::drawCategory(const QModelIndex &index,
+                                   int /*sortRole*/,
+                                   const QStyleOption &option,
+                                   QPainter *painter) const
+{
+    painter->setRenderHint(QPainter::Antialiasing);
+
+    const QString category = index.model()->data(index, VCategorizedSortFilterProxyModel::CategoryDisplayRole).toString();
+    const QRect optRect = option.rect;
+
+    // The decoration only spans the header, the rest of the block is left untouched.
+    // The right corner is antialiased one pixel past the rect
+    const QSize size(optRect.width() + 1, d->fontMetrics.height() + 12);
+    const int ratio = painter->device() ? painter->device()->devicePixelRatio() : 1;
+
+    const QString key = QString::fromLatin1("%1 %2 %3 %4 %5 ")
+                        .arg(size.width())
+                        .arg(size.height())
+                        .arg(option.palette.cacheKey())
+                        .arg(int(option.state))
+                        .arg(ratio) + category;
+
+    QPixmap pixmap;
+    if (QPixmap *cached = d->pixmapCache.object(key)) {
+        pixmap = *cached;
+    } else {
+        pixmap = QPixmap(size * ratio);
+        pixmap.setDevicePixelRatio(ratio);
+        pixmap.fill(Qt::transparent);
+
+        QPainter pixmapPainter(&pixmap);
+        d->paintHeader(&pixmapPainter, QRect(QPoint(0, 0), QSize(optRect.width(), size.height())),
+                       option.palette, category);
+        pixmapPainter.end();
+
+        const int cost = pixmap.width() * pixmap.height() * pixmap.depth() / (8 * 1024);
+        d->pixmapCache.insert(key, new QPixmap(pixmap), qMax(cost, 1));
+    }
+
+    painter->drawPixmap(optRect.topLeft(), pixmap);
+}
+
 int VCategoryDrawer::categoryHeight(const QModelIndex &index, const QStyleOption &option) const
 {
     Q_UNUSED(index);
     Q_UNUSED(option)
 
-    QFont font(QApplication::font());
-    font.setBold(true);
-    QFontMetrics fontMetrics(font);
-
-    const int height = fontMetrics.height() + 1 /* 1 pixel-width gradient */
+    const int height = d->fontMetrics.height() + 1 /* 1 pixel-width gradient */
                        + 11 /* top and bottom separation */;
     return height;
 }
@@ -233,4 +304,23 @@ void VCategoryDrawer::mouseLeft(const QModelIndex &, const QRect &)
 {
 }
 
+bool VCategoryDrawer::eventFilter(QObject *object, QEvent *event)
+{
+    if (object == d->view) {
+        switch (event->type()) {
+        case QEvent::StyleChange:
+        case QEvent::PaletteChange:
+        case QEvent::FontChange:
+        case QEvent::ApplicationFontChange:
+        case QEvent::ApplicationPaletteChange:
+            d->invalidate();
+            break;
+        default:
+            break;
+        }
+    }
+
+    return QObject::eventFilter(object, event);
+}
+
 #include "moc_vcategorydrawer.cpp"
@@ -54,6 +54,10 @@ public:
       *
       * @note This method will be called one time per category, always with the
       *       first element in that category
+      *
+      * @note The default implementation renders each header once into a pixmap,
+      *       and keeps the most recently used ones until the style, the palette
+      *       or the font of the view change
       */
     virtual void drawCategory(const QModelIndex &index,
                               int sortRole,
@@ -175,6 +179,8 @@ protected:
       */
     virtual void mouseLeft(const QModelIndex &index, const QRect &blockRect);
 
+    bool eventFilter(QObject *object, QEvent *event);
+
 private:
     friend class VCategorizedView;
 
@@ -178,6 +178,29 @@ namespace VPrivate
         m_childItems.append(item);
     }
 
+    void FilePlacesItem::insertChildren(int row, const QList<FilePlacesItem *> &items)
+    {
+        for (int i = 0; i < items.size(); ++i) {
+            FilePlacesItem *item = items.at(i);
+            item->setParent(this);
+            item->m_parentItem = this;
+            m_childItems.insert(row + i, item);
+        }
+    }
+
+    QList<FilePlacesItem *> FilePlacesItem::takeChildren(int row, int count)
+    {
+        const QList<FilePlacesItem *> items = m_childItems.mid(row, count);
+        m_childItems.erase(m_childItems.begin() + row, m_childItems.begin() + row + count);
+
+        foreach(FilePlacesItem * item, items) {
+            item->setParent(0);
+            item->m_parentItem = 0;
+        }
+
+        return items;
+    }
+
     FilePlacesItem *FilePlacesItem::childAt(int row)
     {
         return m_childItems.value(row);
@@ -90,6 +90,8 @@ namespace VPrivate
         QString id() const;
 
         void appendChild(FilePlacesItem *item);
+        void insertChildren(int row, const QList<FilePlacesItem *> &items);
+        QList<FilePlacesItem *> takeChildren(int row, int count);
 
         FilePlacesItem *childAt(int row);
         int childCount() const;
@@ -29,11 +29,13 @@
  * $END_LICENSE$
  ***************************************************************************/
 
-#include <QDebug>
 #include <QDir>
 #include <QFile>
+#include <QHash>
 #include <QIcon>
+#include <QSet>
 #include <QTimer>
+#include <QVector>
 #include <QAction>
 #include <QStandardPaths>
 
@@ -130,11 +132,8 @@ VFilePlacesModelPrivate::VFilePlacesModelPrivate(VFilePlacesModel *parent) :
 
 VFilePlacesModelPrivate::~VFilePlacesModelPrivate()
 {
-    qDeleteAll(favoriteItems);
-    qDeleteAll(deviceItems);
+    // Top-level items and their children are owned by the root item
     delete rootItem;
-    delete favoritesRootItem;
-    delete devicesRootItem;
 }
 
 QList<FilePlacesItem *> VFilePlacesModelPrivate::loadFavoritesList()
@@ -151,15 +150,15 @@ QList<FilePlacesItem *> VFilePlacesModelPrivate::loadFavoritesList()
 
         // TODO: Check if OnlyInApp metadata is available and matches with current application's name
 
+        // Items are adopted by the top-level item when the list is reloaded
         FilePlacesItem *item = 0;
         if (udi.isEmpty())
             item = new FilePlacesItem(bookmarkManager,
                                       bookmark.address(),
-                                      favoritesRootItem);
+                                      static_cast<FilePlacesItem *>(0));
         else
             item = new FilePlacesItem(bookmarkManager,
-                                      bookmark.address(), udi,
-                                      favoritesRootItem);
+                                      bookmark.address(), udi);
         QObject::connect(item, SIGNAL(itemChanged(const QString &)),
                          q, SLOT(_q_itemChanged(const QString &)));
         list << item;
@@ -184,8 +183,7 @@ QList<FilePlacesItem *> VFilePlacesModelPrivate::loadDevicesList()
         if (!bookmark.isNull()) {
             FilePlacesItem *item =
                 new FilePlacesItem(bookmarkManager,
-                                   bookmark.address(),
-                                   udi, devicesRootItem);
+                                   bookmark.address(), udi);
             QObject::connect(item, SIGNAL(itemChanged(QString)),
                              q, SLOT(_q_itemChanged(QString)));
             list << item;
@@ -201,77 +199,146 @@ void VFilePlacesModelPrivate::reloadList(const QModelIndex &parent,
 {
     Q_Q(VFilePlacesModel);
 
-    qDebug() << "-----" << parent.data(Qt::DisplayRole).toString();
-    QList<FilePlacesItem *>::Iterator it_i = items.begin();
-    QList<FilePlacesItem *>::Iterator it_c = currentItems.begin();
+    FilePlacesItem *parentItem = static_cast<FilePlacesItem *>(parent.internalPointer());
 
-    QList<FilePlacesItem *>::Iterator end_i = items.end();
-    QList<FilePlacesItem *>::Iterator end_c = currentItems.end();
+    /*
+     * Items are matched by id. The items that are gone are removed, then
+     * the list is walked in the new order: matched items take the loaded
+     * bookmark, misplaced ones are moved up and new ones are inserted.
+     * Consecutive rows are handled with a single signal.
+     */
+    QSet<QString> currentIds;
+    foreach(FilePlacesItem * item, currentItems) {
+        currentIds.insert(item->id());
+    }
 
-    while (it_i != end_i || it_c != end_c) {
-        if (it_i == end_i && it_c != end_c) {
-            int row = items.count();
+    // Remove from the bottom, so that the rows above stay valid
+    QVector<bool> keep(items.size());
+    QSet<QString> keptIds;
+    for (int row = 0; row < items.size(); ++row) {
+        const QString id = items.at(row)->id();
+        keep[row] = currentIds.contains(id) && !keptIds.contains(id);
+        keptIds.insert(id);
+    }
+    for (int last = items.size() - 1; last >= 0; --last) {
+        if (keep.at(last))
+            continue;
 
-            qDebug() << "inserting row" << row;
-            q->beginInsertRows(parent, row, row);
-            it_i = items.insert(it_i, *it_c);
-            ++it_i;
-            it_c = currentItems.erase(it_c);
+        int first = last;
+        while (first > 0 && !keep.at(first - 1))
+            --first;
 
-            end_i = items.end();
-            end_c = currentItems.end();
-            q->endInsertRows();
-        } else if (it_i != end_i && it_c == end_c) {
-            int row = items.indexOf(*it_i);
-
-            qDebug() << "removing row" << row;
-            q->beginRemoveRows(parent, row, row);
-            delete *it_i;
-            it_i = items.erase(it_i);
-
-            end_i = items.end();
-            end_c = currentItems.end();
-            q->endRemoveRows();
-        } else if ((*it_i)->id() == (*it_c)->id()) {
-            bool shouldEmit = !((*it_i)->bookmark() == (*it_c)->bookmark());
-            (*it_i)->setBookmark((*it_c)->bookmark());
-            if (shouldEmit) {
-                int row = items.indexOf(*it_i);
-                qDebug() << "changing row" << row;
-                QModelIndex idx = q->index(row, 0, parent);
-                emit q->dataChanged(idx, idx);
-            }
-            ++it_i;
-            ++it_c;
-        } else if ((*it_i)->id() != (*it_c)->id()) {
-            int row = items.indexOf(*it_i);
-
-            // If the next one matches, it's a remove
-            if (it_i + 1 != end_i && (*(it_i + 1))->id() == (*it_c)->id()) {
-                qDebug() << "2 removing row" << row;
-                q->beginRemoveRows(parent, row, row);
-                delete *it_i;
-                it_i = items.erase(it_i);
-
-                end_i = items.end();
-                end_c = currentItems.end();
-                q->endRemoveRows();
-            } else {
-                qDebug() << "2 inserting row" << row;
-                q->beginInsertRows(parent, row, row);
-                it_i = items.insert(it_i, *it_c);
-                ++it_i;
-                it_c = currentItems.erase(it_c);
-
-                end_i = items.end();
-                end_c = currentItems.end();
-                q->endInsertRows();
+        q->beginRemoveRows(parent, first, last);
+        items.erase(items.begin() + first, items.begin() + last + 1);
+        qDeleteAll(parentItem->takeChildren(first, last - first + 1));
+        q->endRemoveRows();
+
+        last = first;
+    }
+
+    QHash<QString, FilePlacesItem *> remaining;
+    foreach(FilePlacesItem * item, items) {
+        remaining.insert(item->id(), item);
+    }
+
+    QList<int> changedRows;
+    int row = 0;
+    while (row < currentItems.size()) {
+        FilePlacesItem *current = currentItems.at(row);
+        FilePlacesItem *item = remaining.value(current->id());
+
+        if (!item) {
+            int last = row;
+            while (last + 1 < currentItems.size() && !remaining.contains(currentItems.at(last + 1)->id()))
+                ++last;
+
+            const QList<FilePlacesItem *> inserted = currentItems.mid(row, last - row + 1);
+            q->beginInsertRows(parent, row, last);
+            for (int i = 0; i < inserted.size(); ++i) {
+                items.insert(row + i, inserted.at(i));
+                currentItems[row + i] = 0;
             }
+            parentItem->insertChildren(row, inserted);
+            q->endInsertRows();
+
+            row = last + 1;
+            continue;
+        }
+
+        if (items.at(row) != item) {
+            // Items before this row are in place already, bring up the
+            // run that follows in the same order in both lists
+            const int from = items.indexOf(item, row + 1);
+            int count = 1;
+            while (row + count < currentItems.size() && from + count < items.size() &&
+                    items.at(from + count)->id() == currentItems.at(row + count)->id())
+                ++count;
+
+            q->beginMoveRows(parent, from, from + count - 1, parent, row);
+            const QList<FilePlacesItem *> moved = items.mid(from, count);
+            items.erase(items.begin() + from, items.begin() + from + count);
+            for (int i = 0; i < moved.size(); ++i)
+                items.insert(row + i, moved.at(i));
+            parentItem->insertChildren(row, parentItem->takeChildren(from, count));
+            q->endMoveRows();
         }
+
+        remaining.remove(current->id());
+        if (!(item->bookmark() == current->bookmark())) {
+            item->setBookmark(current->bookmark());
+            changedRows.append(row);
+        }
+        ++row;
     }
 
+    Q_ASSERT(items.size() == currentItems.size());
+
+    // Changed rows are in ascending order, notify them by ranges
+    for (int first = 0; first < changedRows.size();) {
+        int last = first;
+        while (last + 1 < changedRows.size() && changedRows.at(last + 1) == changedRows.at(last) + 1)
+            ++last;
+        emit q->dataChanged(q->index(changedRows.at(first), 0, parent),
+                            q->index(changedRows.at(last), 0, parent));
+        first = last + 1;
+    }
+
+    // Loaded items that were not inserted are duplicates of existing ones
     qDeleteAll(currentItems);
-    currentItems.clear();
+}
+
+QString VFilePlacesModelPrivate::urlTrieKey(const QUrl &url)
+{
+    // Like QUrl::isParentOf(), URLs without a scheme match local places
+    const QString scheme = url.scheme().isEmpty() ? QStringLiteral("file") : url.scheme();
+    return scheme + QStringLiteral("://") + url.authority();
+}
+
+void VFilePlacesModelPrivate::rebuildUrlTrie()
+{
+    qDeleteAll(urlTrie.children);
+    urlTrie.children.clear();
+
+    for (int row = 0; row < favoritesRootItem->childCount(); ++row) {
+        const QUrl url = favoritesRootItem->childAt(row)->data(VFilePlacesModel::UrlRole).toUrl();
+        if (url.isEmpty())
+            continue;
+
+        UrlNode *&top = urlTrie.children[urlTrieKey(url)];
+        if (!top)
+            top = new UrlNode();
+
+        UrlNode *node = top;
+        foreach(const QString & component, url.path().split(QLatin1Char('/'), QString::SkipEmptyParts)) {
+            UrlNode *&child = node->children[component];
+            if (!child)
+                child = new UrlNode();
+            node = child;
+        }
+
+        if (node->row < 0)
+            node->row = row;
+    }
 }
 
 void VFilePlacesModelPrivate::_q_initDeviceList()
@@ -315,14 +382,20 @@ void VFilePlacesModelPrivate::_q_itemChanged(const QString &id)
     Q_Q(VFilePlacesModel);
 
     // Emit a signal for favorite items that had changed
+    bool favoriteChanged = false;
     for (int row = 0; row < favoritesRootItem->childCount(); ++row) {
         if (favoritesRootItem->childAt(row)->id() == id) {
             QModelIndex parent = q->index(0, 0, QModelIndex());
             QModelIndex index = q->index(row, 0, parent);
             emit q->dataChanged(index, index);
+            favoriteChanged = true;
         }
     }
 
+    // The URL of a device place changes when it's mounted
+    if (favoriteChanged)
+        rebuildUrlTrie();
+
     // Emit a signal for device items that had changed
     for (int row = 0; row < devicesRootItem->childCount(); ++row) {
         if (devicesRootItem->childAt(row)->id() == id) {
@@ -339,6 +412,7 @@ void VFilePlacesModelPrivate::_q_reloadFavorites()
 
     QList<FilePlacesItem *> favorites = loadFavoritesList();
     reloadList(q->index(0, 0, QModelIndex()), favorites, favoriteItems);
+    rebuildUrlTrie();
 }
 
 void VFilePlacesModelPrivate::_q_reloadDevices()
@@ -545,25 +619,23 @@ QModelIndex VFilePlacesModel::closestItem(const QUrl &url) const
 {
     Q_D(const VFilePlacesModel);
 
-    int foundRow = -1;
-    int maxLength = 0;
-
     /*
-     * Search the item which is equal to the URL passed as argument or at least
-     * is a parent.  If there are more than one possible candidates, choose the item
-     * which covers the bigger range.
+     * Walk down the trie of favorite places along the path of the URL, the
+     * deepest place found on the way is equal to the URL or is the parent
+     * that covers the bigger range.
      */
-    for (int row = 0; row < d->favoritesRootItem->childCount(); ++row) {
-        FilePlacesItem *item = d->favoritesRootItem->childAt(row);
-
-        QUrl itemUrl = item->data(UrlRole).toUrl();
-        if (itemUrl.isParentOf(url)) {
-            const int length = itemUrl.toEncoded(QUrl::RemovePassword).length();
-            if (length > maxLength) {
-                foundRow = row;
-                maxLength = length;
-            }
-        }
+    const VFilePlacesModelPrivate::UrlNode *node =
+        d->urlTrie.children.value(VFilePlacesModelPrivate::urlTrieKey(url));
+    if (!node)
+        return QModelIndex();
+
+    int foundRow = node->row;
+    foreach(const QString & component, url.path().split(QLatin1Char('/'), QString::SkipEmptyParts)) {
+        node = node->children.value(component);
+        if (!node)
+            break;
+        if (node->row >= 0)
+            foundRow = node->row;
     }
 
     if (foundRow == -1)
@@ -59,6 +59,24 @@ public:
     VFilePlacesModelPrivate(VFilePlacesModel *parent);
     ~VFilePlacesModelPrivate();
 
+    /*
+     * Node of the trie of favorite places, keyed by URL path components
+     * below a first level keyed by scheme and authority.
+     */
+    struct UrlNode {
+        UrlNode() : row(-1) {}
+        ~UrlNode() {
+            qDeleteAll(children);
+        }
+
+        // Row of the first favorite with this URL, -1 if there is none
+        int row;
+        QHash<QString, UrlNode *> children;
+
+    private:
+        Q_DISABLE_COPY(UrlNode)
+    };
+
     VPrivate::FilePlacesItem *rootItem;
     VPrivate::FilePlacesItem *favoritesRootItem;
     VPrivate::FilePlacesItem *devicesRootItem;
@@ -71,6 +89,8 @@ public:
 
     QMap<QObject *, QPersistentModelIndex> setupInProgress;
 
+    UrlNode urlTrie;
+
     VBookmarkManager *bookmarkManager;
 
     VFilePlacesModel *const q_ptr;
@@ -81,6 +101,9 @@ public:
                     QList<VPrivate::FilePlacesItem *> currentItems,
                     QList<VPrivate::FilePlacesItem *> &items);
 
+    static QString urlTrieKey(const QUrl &url);
+    void rebuildUrlTrie();
+
     void _q_initDeviceList();
     void _q_deviceAdded(const QString &udi);
     void _q_deviceRemoved(const QString &udi);
@@ -25,154 +25,516 @@
  * $END_LICENSE$
  ***************************************************************************/
 
+#include <QDateTime>
+#include <QDir>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QRunnable>
+#include <QSet>
 #include <QStyle>
 #include <QStandardPaths>
+#include <QThreadPool>
 #include <QFileIconProvider>
 
-#include <VibeCore/VDesktopFile>
+#include <VibeCore/VibeCoreExport>
 
+#include "vdesktopentryparser_p.h"
 #include "vfilesystemmodel.h"
 
-class VFileIconProvider : public QFileIconProvider
+/*
+ * Display name, MIME type and icon of a file, resolved once and shared
+ * by the model and the icon provider.  Entries are keyed by path and
+ * stale as soon as the modification time changes.
+ *
+ * The icon provider is called by the QFileSystemModel gatherer thread,
+ * hence the lock.  Theme lookups are not thread-safe: resolving only
+ * lists the candidate icons, one of them is picked on the GUI thread.
+ *
+ * The model doesn't wait for entries to be resolved on the GUI thread:
+ * lookup() returns a guess based on the file name and queues the file
+ * for worker threads.  Requests come from painting, so the most recent
+ * ones are served first and the oldest are dropped when the queue is
+ * full, they belong to rows that were scrolled away.  Resolved paths are
+ * collected and the receiver is told once per batch.
+ */
+class VFileInfoCache
 {
 public:
-    VFileIconProvider();
+    struct Entry {
+        Entry()
+            : iconIsFile(false)
+            , guessed(false) {
+        }
 
-    QIcon icon(const QFileInfo &fileInfo) const;
-    QString type(const QFileInfo &fileInfo) const;
+        QDateTime lastModified;
+        QString displayName;
+        QString mimeType;
+        QString mimeComment;
+        QString iconName;
+        // Icons to look for in the theme, iconName is used if none is found
+        QStringList iconNames;
+        bool iconIsFile;
+        bool guessed;
+    };
+
+    VFileInfoCache();
+    ~VFileInfoCache();
+
+    void setReceiver(QObject *receiver, const char *member);
+
+    Entry entry(const QFileInfo &fileInfo);
+    Entry lookup(const QFileInfo &fileInfo);
+    QIcon icon(const QString &iconName);
+
+    void remove(const QString &path);
+    QStringList takeResolved();
 
 private:
+    friend class VFileInfoResolver;
+
+    enum {
+        MaxQueued = 256,
+        MaxWorkers = 2
+    };
+
+    QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    QList<QFileInfo> m_queue;
+    QSet<QString> m_queued;
+    QStringList m_resolved;
+    int m_workers;
+    QObject *m_receiver;
+    const char *m_member;
+    QThreadPool m_pool;
+    QHash<QString, QIcon> m_icons;
+    QHash<QString, QStandardPaths::StandardLocation> m_standardLocations;
+    QHash<QString, QString> m_standardIcons;
     QMimeDatabase m_mimeDatabase;
+
+    Entry guess(const QFileInfo &fileInfo) const;
+    Entry resolve(const QFileInfo &fileInfo) const;
+    void resolveQueued();
+
+    static void pickIconName(Entry &entry);
 };
 
-VFileIconProvider::VFileIconProvider()
-    : QFileIconProvider()
+class VFileInfoResolver : public QRunnable
+{
+public:
+    VFileInfoResolver(VFileInfoCache *cache)
+        : m_cache(cache) {
+    }
+
+    void run() {
+        m_cache->resolveQueued();
+    }
+
+private:
+    VFileInfoCache *m_cache;
+};
+
+VFileInfoCache::VFileInfoCache()
+    : m_workers(0)
+    , m_receiver(0)
+    , m_member(0)
+{
+    // Writable locations don't change while running, look them up once
+    static const struct {
+        QStandardPaths::StandardLocation location;
+        const char *iconName;
+    } locations[] = {
+        { QStandardPaths::DesktopLocation, "user-desktop" },
+        { QStandardPaths::DocumentsLocation, "folder-documents" },
+        { QStandardPaths::FontsLocation, "folder-fonts" },
+        { QStandardPaths::ApplicationsLocation, "folder-applications" },
+        { QStandardPaths::MusicLocation, "folder-music" },
+        { QStandardPaths::MoviesLocation, "folder-video" },
+        { QStandardPaths::PicturesLocation, "folder-pictures" },
+        { QStandardPaths::HomeLocation, "user-home" },
+        { QStandardPaths::DownloadLocation, "folder-download" }
+    };
+
+    for (unsigned int i = 0; i < sizeof(locations) / sizeof(locations[0]); i++) {
+        QString path = QStandardPaths::writableLocation(locations[i].location);
+        if (!path.isEmpty() && !m_standardLocations.contains(path)) {
+            m_standardLocations.insert(path, locations[i].location);
+            m_standardIcons.insert(path, QLatin1String(locations[i].iconName));
+        }
+    }
+}
+
+VFileInfoCache::~VFileInfoCache()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_queue.clear();
+        m_queued.clear();
+        m_receiver = 0;
+    }
+
+    m_pool.waitForDone();
+}
+
+void VFileInfoCache::setReceiver(QObject *receiver, const char *member)
+{
+    QMutexLocker locker(&m_mutex);
+    m_receiver = receiver;
+    m_member = member;
+}
+
+VFileInfoCache::Entry VFileInfoCache::entry(const QFileInfo &fileInfo)
+{
+    const QString path = fileInfo.absoluteFilePath();
+    const QDateTime lastModified = fileInfo.lastModified();
+
+    {
+        QMutexLocker locker(&m_mutex);
+        QHash<QString, Entry>::const_iterator it = m_entries.constFind(path);
+        if (it != m_entries.constEnd() && !it.value().guessed &&
+                it.value().lastModified == lastModified)
+            return it.value();
+    }
+
+    // Resolve without holding the lock, it may read files
+    Entry entry = resolve(fileInfo);
+    entry.lastModified = lastModified;
+
+    QMutexLocker locker(&m_mutex);
+    m_entries.insert(path, entry);
+    return entry;
+}
+
+VFileInfoCache::Entry VFileInfoCache::lookup(const QFileInfo &fileInfo)
+{
+    const QString path = fileInfo.absoluteFilePath();
+    const QDateTime lastModified = fileInfo.lastModified();
+
+    QMutexLocker locker(&m_mutex);
+
+    QHash<QString, Entry>::iterator it = m_entries.find(path);
+    if (it != m_entries.end() && it.value().lastModified == lastModified) {
+        // Resolved by the icon provider, or not taken yet
+        if (!it.value().iconNames.isEmpty())
+            pickIconName(it.value());
+        if (!it.value().guessed || m_queued.contains(path))
+            return it.value();
+    } else {
+        // Guessing doesn't touch the file, it's fine to hold the lock
+        Entry entry = guess(fileInfo);
+        entry.lastModified = lastModified;
+        it = m_entries.insert(path, entry);
+    }
+
+    // Queue the file, or move it to the front if it was already queued
+    if (m_queued.contains(path)) {
+        for (int i = m_queue.size() - 1; i >= 0; i--) {
+            if (m_queue.at(i).absoluteFilePath() == path) {
+                m_queue.removeAt(i);
+                break;
+            }
+        }
+    }
+    m_queue.append(fileInfo);
+    m_queued.insert(path);
+
+    if (m_queue.size() > MaxQueued)
+        m_queued.remove(m_queue.takeFirst().absoluteFilePath());
+
+    if (m_workers < MaxWorkers) {
+        m_workers++;
+        m_pool.start(new VFileInfoResolver(this));
+    }
+
+    return it.value();
+}
+
+QIcon VFileInfoCache::icon(const QString &iconName)
+{
+    QMutexLocker locker(&m_mutex);
+
+    QHash<QString, QIcon>::const_iterator it = m_icons.constFind(iconName);
+    if (it != m_icons.constEnd())
+        return it.value();
+
+    QIcon icon = QIcon::fromTheme(iconName);
+    m_icons.insert(iconName, icon);
+    return icon;
+}
+
+void VFileInfoCache::remove(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.remove(path);
+    m_queued.remove(path);
+}
+
+QStringList VFileInfoCache::takeResolved()
+{
+    QMutexLocker locker(&m_mutex);
+    QStringList resolved = m_resolved;
+    m_resolved.clear();
+
+    // Called on the GUI thread, where the theme can be queried
+    foreach (const QString &path, resolved) {
+        QHash<QString, Entry>::iterator it = m_entries.find(path);
+        if (it != m_entries.end())
+            pickIconName(it.value());
+    }
+
+    return resolved;
+}
+
+void VFileInfoCache::resolveQueued()
 {
+    QMutexLocker locker(&m_mutex);
+
+    while (!m_queue.isEmpty()) {
+        const QFileInfo fileInfo = m_queue.takeLast();
+        const QString path = fileInfo.absoluteFilePath();
+
+        locker.unlock();
+        Entry entry = resolve(fileInfo);
+        entry.lastModified = fileInfo.lastModified();
+        locker.relock();
+
+        // Don't store the result if the file was removed meanwhile
+        if (!m_queued.remove(path))
+            continue;
+        m_entries.insert(path, entry);
+
+        // Notify once per batch, the receiver takes all the paths
+        m_resolved.append(path);
+        if (m_resolved.size() == 1 && m_receiver)
+            QMetaObject::invokeMethod(m_receiver, m_member, Qt::QueuedConnection);
+    }
+
+    m_workers--;
 }
 
-QIcon VFileIconProvider::icon(const QFileInfo &fileInfo) const
+VFileInfoCache::Entry VFileInfoCache::guess(const QFileInfo &fileInfo) const
 {
-    static QMap<QStandardPaths::StandardLocation, QString> iconsMap;
-    iconsMap[QStandardPaths::DesktopLocation] = "user-desktop";
-    iconsMap[QStandardPaths::DocumentsLocation] = "folder-documents";
-    iconsMap[QStandardPaths::FontsLocation] = "folder-fonts";
-    iconsMap[QStandardPaths::ApplicationsLocation] = "folder-applications";
-    iconsMap[QStandardPaths::MusicLocation] = "folder-music";
-    iconsMap[QStandardPaths::MoviesLocation] = "folder-video";
-    iconsMap[QStandardPaths::PicturesLocation] = "folder-pictures";
-    iconsMap[QStandardPaths::HomeLocation] = "user-home";
-    iconsMap[QStandardPaths::DownloadLocation] = "folder-download";
+    Entry entry;
+    entry.guessed = true;
+
+    if (fileInfo.isDir()) {
+        // Standard paths are known, .directory files have to be read
+        QHash<QString, QStandardPaths::StandardLocation>::const_iterator it =
+            m_standardLocations.constFind(fileInfo.absoluteFilePath());
+        if (it != m_standardLocations.constEnd()) {
+            entry.displayName = QStandardPaths::displayName(it.value());
+            entry.iconName = m_standardIcons.value(it.key());
+        }
+    } else {
+        // Match the extension only, the content is sniffed later
+        QMimeType type = m_mimeDatabase.mimeTypeForFile(fileInfo.fileName(), QMimeDatabase::MatchExtension);
+        entry.mimeType = type.name();
+        entry.mimeComment = type.comment();
+        entry.iconName = type.iconName();
+        if (entry.iconName.isEmpty() || type.isDefault())
+            entry.iconName = QStringLiteral("text-x-preview");
+    }
+
+    return entry;
+}
+
+static QString desktopEntryValue(const VDesktopEntryParser::Values &values,
+                                 const VDesktopEntryParser::Values &localized,
+                                 const QString &key)
+{
+    VDesktopEntryParser::Values::const_iterator it = localized.constFind(key);
+    if (it == localized.constEnd()) {
+        it = values.constFind(key);
+        if (it == values.constEnd())
+            return QString();
+    }
+    return VDesktopEntryParser::toString(it.value());
+}
+
+VFileInfoCache::Entry VFileInfoCache::resolve(const QFileInfo &fileInfo) const
+{
+    Entry entry;
+
+    // Desktop files are parsed directly, VDesktopFile is for the GUI thread only
+    VDesktopEntryParser::Values values, localized;
 
     if (fileInfo.isDir()) {
         // Read .directory desktop file
-        QString desktopFileName = fileInfo.dir().absoluteFilePath(".directory");
-        if (fileInfo.isDir() && QFile::exists(desktopFileName)) {
-            VDesktopFile desktopFile(desktopFileName);
-            if (QIcon::hasThemeIcon(desktopFile.iconName()))
-                return QIcon::fromTheme(desktopFile.iconName());
+        QString desktopFileName = QDir(fileInfo.absoluteFilePath()).absoluteFilePath(".directory");
+        if (QFile::exists(desktopFileName) && VDesktopEntryParser::parseFile(desktopFileName, values)) {
+            VDesktopEntryParser::resolveLocalized(values, localized);
+            entry.displayName = desktopEntryValue(values, localized, QStringLiteral("Name"));
+            entry.iconNames.append(desktopEntryValue(values, localized, QStringLiteral("Icon")));
         }
 
-        // Standard paths icons
-        foreach(QStandardPaths::StandardLocation key, iconsMap.keys()) {
-            if (fileInfo.absoluteFilePath() == QStandardPaths::writableLocation(key)) {
-                if (QIcon::hasThemeIcon(iconsMap[key]))
-                    return QIcon::fromTheme(iconsMap[key]);
-            }
+        // Standard paths names and icons
+        QHash<QString, QStandardPaths::StandardLocation>::const_iterator it =
+            m_standardLocations.constFind(fileInfo.absoluteFilePath());
+        if (it != m_standardLocations.constEnd()) {
+            if (entry.displayName.isEmpty())
+                entry.displayName = QStandardPaths::displayName(it.value());
+            entry.iconNames.append(m_standardIcons.value(it.key()));
         }
     } else {
         // Icon from the MIME database
         QMimeType type = m_mimeDatabase.mimeTypeForFile(fileInfo);
+        entry.mimeType = type.name();
+        entry.mimeComment = type.comment();
         QString iconName = type.iconName();
 
-        // If it's a desktop file try to load its icon
+        // If it's a desktop file try to load its name and icon
         if (type.name() == "application/x-desktop") {
-            VDesktopFile desktopFile(fileInfo.absoluteFilePath());
-            iconName = desktopFile.iconName();
+            VDesktopEntryParser::parseFile(fileInfo.absoluteFilePath(), values);
+            VDesktopEntryParser::resolveLocalized(values, localized);
+            entry.displayName = desktopEntryValue(values, localized, QStringLiteral("Name"));
+            iconName = desktopEntryValue(values, localized, QStringLiteral("Icon"));
 
             // Load an image file if the desktop file uses an absolute path
-            if (QFile::exists(iconName))
-                return QIcon(iconName);
+            if (QFile::exists(iconName)) {
+                entry.iconName = iconName;
+                entry.iconIsFile = true;
+                return entry;
+            }
         }
 
-        // If the icon is not available try with a generic name
-        if (!QIcon::hasThemeIcon(iconName)) {
-            if (fileInfo.isExecutable())
-                iconName = QStringLiteral("application-x-executable");
-            else if (QIcon::hasThemeIcon(type.genericIconName()))
-                iconName = type.genericIconName();
+        // If the icon is not available try with a generic name,
+        // fallback to the default icon
+        entry.iconNames.append(iconName);
+        if (fileInfo.isExecutable()) {
+            entry.iconName = QStringLiteral("application-x-executable");
+        } else {
+            entry.iconNames.append(type.genericIconName());
+            entry.iconName = QStringLiteral("text-x-preview");
         }
+    }
 
-        // Fallback to the default icon
-        if (iconName.isEmpty())
-            iconName = QStringLiteral("text-x-preview");
+    entry.iconNames.removeAll(QString());
+    return entry;
+}
 
-        // Return the icon we found above
-        return QIcon::fromTheme(iconName);
+void VFileInfoCache::pickIconName(Entry &entry)
+{
+    foreach (const QString &iconName, entry.iconNames) {
+        if (QIcon::hasThemeIcon(iconName)) {
+            entry.iconName = iconName;
+            break;
+        }
     }
+    entry.iconNames.clear();
+}
+
+// Icons are served by the model on the GUI thread, only types come from here
+class VFileIconProvider : public QFileIconProvider
+{
+public:
+    VFileIconProvider(const QSharedPointer<VFileInfoCache> &cache);
 
-    return QFileIconProvider::icon(fileInfo);
+    QString type(const QFileInfo &fileInfo) const;
+
+private:
+    QSharedPointer<VFileInfoCache> m_cache;
+};
+
+VFileIconProvider::VFileIconProvider(const QSharedPointer<VFileInfoCache> &cache)
+    : QFileIconProvider()
+    , m_cache(cache)
+{
 }
 
 QString VFileIconProvider::type(const QFileInfo &fileInfo) const
 {
     // MIME type description for files
-    if (!fileInfo.isDir()) {
-        QMimeType type = m_mimeDatabase.mimeTypeForFile(fileInfo);
-        return type.comment();
-    }
+    if (!fileInfo.isDir())
+        return m_cache->entry(fileInfo).mimeComment;
 
     return QFileIconProvider::type(fileInfo);
 }
 
 VFileSystemModel::VFileSystemModel(QObject *parent)
     : QFileSystemModel(parent)
+    , m_cache(new VFileInfoCache())
+    , m_iconProvider(new VFileIconProvider(m_cache))
 {
-    setIconProvider(new VFileIconProvider());
+    // QFileSystemModel doesn't take ownership of the icon provider
+    setIconProvider(m_iconProvider.data());
+    m_cache->setReceiver(this, "slotEntriesResolved");
+
+    connect(this, SIGNAL(rowsAboutToBeRemoved(QModelIndex, int, int)),
+            this, SLOT(slotRowsAboutToBeRemoved(QModelIndex, int, int)));
+    connect(this, SIGNAL(fileRenamed(QString, QString, QString)),
+            this, SLOT(slotFileRenamed(QString, QString, QString)));
+}
+
+VFileSystemModel::~VFileSystemModel()
+{
+    m_cache->setReceiver(0, 0);
 }
 
 QVariant VFileSystemModel::data(const QModelIndex &index, int role) const
 {
-    QFileInfo fileInfo(filePath(index));
-
-    static QMap<QStandardPaths::StandardLocation, QString> iconsMap;
-    iconsMap[QStandardPaths::DesktopLocation] = "user-desktop";
-    iconsMap[QStandardPaths::DocumentsLocation] = "folder-documents";
-    iconsMap[QStandardPaths::FontsLocation] = "folder-fonts";
-    iconsMap[QStandardPaths::ApplicationsLocation] = "folder-applications";
-    iconsMap[QStandardPaths::MusicLocation] = "folder-music";
-    iconsMap[QStandardPaths::MoviesLocation] = "folder-video";
-    iconsMap[QStandardPaths::PicturesLocation] = "folder-pictures";
-    iconsMap[QStandardPaths::HomeLocation] = "user-home";
-    iconsMap[QStandardPaths::DownloadLocation] = "folder-download";
-
-    if (role == Qt::DisplayRole && index.column() == 0) {
-        if (fileInfo.isDir()) {
-            // Read .directory desktop file
-            QString desktopFileName = fileInfo.dir().absoluteFilePath(".directory");
-            if (fileInfo.isDir() && QFile::exists(desktopFileName)) {
-                VDesktopFile desktopFile(desktopFileName);
-                if (desktopFile.isValid())
-                    return desktopFile.name();
-            }
+    if (index.column() == 0 && (role == Qt::DisplayRole || role == Qt::DecorationRole)) {
+        // The model already has the file information, don't stat again;
+        // this returns a guess until the file is resolved in background
+        VFileInfoCache::Entry entry = m_cache->lookup(fileInfo(index));
 
-            // Standard paths names
-            foreach(QStandardPaths::StandardLocation key, iconsMap.keys()) {
-                if (fileInfo.absoluteFilePath() == QStandardPaths::writableLocation(key))
-                    return QStandardPaths::displayName(key);
-            }
-        } else {
-            QMimeType type = m_mimeDatabase.mimeTypeForFile(fileInfo);
+        if (role == Qt::DisplayRole && !entry.displayName.isEmpty())
+            return entry.displayName;
 
-            // If it's a desktop file try to load it
-            if (type.name() == "application/x-desktop") {
-                VDesktopFile desktopFile(fileInfo.absoluteFilePath());
-                if (!desktopFile.name().isEmpty())
-                    return desktopFile.name();
-            }
+        if (role == Qt::DecorationRole) {
+            if (entry.iconIsFile)
+                return QIcon(entry.iconName);
+            if (!entry.iconName.isEmpty())
+                return m_cache->icon(entry.iconName);
         }
     }
 
     return QFileSystemModel::data(index, role);
 }
 
+void VFileSystemModel::slotRowsAboutToBeRemoved(const QModelIndex &parent, int start, int end)
+{
+    for (int row = start; row <= end; row++)
+        m_cache->remove(filePath(index(row, 0, parent)));
+}
+
+void VFileSystemModel::slotFileRenamed(const QString &path, const QString &oldName, const QString &newName)
+{
+    Q_UNUSED(newName);
+
+    m_cache->remove(QDir(path).absoluteFilePath(oldName));
+}
+
+void VFileSystemModel::slotEntriesResolved()
+{
+    // Group the resolved rows by parent and notify contiguous ranges
+    QHash<QModelIndex, QList<int> > rowsByParent;
+    foreach (const QString &path, m_cache->takeResolved()) {
+        QModelIndex resolved = index(path);
+        if (resolved.isValid())
+            rowsByParent[resolved.parent()].append(resolved.row());
+    }
+
+    const QVector<int> roles = QVector<int>() << Qt::DisplayRole << Qt::DecorationRole;
+
+    QHash<QModelIndex, QList<int> >::iterator it;
+    for (it = rowsByParent.begin(); it != rowsByParent.end(); ++it) {
+        QList<int> &rows = it.value();
+        qSort(rows);
+
+        int first = rows.at(0);
+        int last = first;
+        for (int i = 1; i <= rows.size(); i++) {
+            if (i < rows.size() && rows.at(i) <= last + 1) {
+                last = rows.at(i);
+                continue;
+            }
+
+            emit dataChanged(index(first, 0, it.key()), index(last, 0, it.key()), roles);
+            if (i < rows.size())
+                first = last = rows.at(i);
+        }
+    }
+}
+
 #include "moc_vfilesystemmodel.cpp"
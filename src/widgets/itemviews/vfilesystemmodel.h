@@ -30,19 +30,30 @@
 
 #include <QMimeDatabase>
 #include <QFileSystemModel>
+#include <QScopedPointer>
+#include <QSharedPointer>
 
 #include <VibeWidgets/VibeWidgetsExport>
 
+class VFileInfoCache;
+
 class VIBEWIDGETS_EXPORT VFileSystemModel : public QFileSystemModel
 {
     Q_OBJECT
 public:
     explicit VFileSystemModel(QObject *parent = 0);
+    ~VFileSystemModel();
 
     QVariant data(const QModelIndex &index, int role) const;
 
+private slots:
+    void slotRowsAboutToBeRemoved(const QModelIndex &parent, int start, int end);
+    void slotFileRenamed(const QString &path, const QString &oldName, const QString &newName);
+    void slotEntriesResolved();
+
 private:
-    QMimeDatabase m_mimeDatabase;
+    QSharedPointer<VFileInfoCache> m_cache;
+    QScopedPointer<QFileIconProvider> m_iconProvider;
 };
 
 #endif // VFILESYSTEMMODEL_H
@@ -0,0 +1,111 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:BSD$
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of the Hawaii Project nor the
+ *      names of its contributors may be used to endorse or promote products
+ *      derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Pier Luigi Fiorini BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $END_LICENSE$
+ */
+
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <VibeCore/VBookmark>
+#include <VibeCore/VBookmarkManager>
+
+/*
+ * Checks that changes waiting for the save delay are not lost
+ * when the bookmarks file is reloaded.
+ */
+
+class TestBookmarkManager : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void delayedSaveSurvivesReload();
+};
+
+static bool writeBookmarks(const QString &fileName, const QString &url)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    file.write(QString("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                       "<!DOCTYPE xbel>\n"
+                       "<xbel>\n"
+                       " <bookmark href=\"%1\"><title>Bookmark</title></bookmark>\n"
+                       "</xbel>\n").arg(url).toUtf8());
+    return true;
+}
+
+static QByteArray readBookmarks(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readAll();
+}
+
+void TestBookmarkManager::delayedSaveSurvivesReload()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QString fileName = dir.path() + "/bookmarks.xml";
+    QVERIFY(writeBookmarks(fileName, "http://example.org/first"));
+
+    VBookmarkManager *manager = VBookmarkManager::managerForExternalFile(fileName);
+    manager->setSaveDelay(60000);
+
+    VBookmarkGroup root = manager->root();
+    root.addBookmark("Pending", QUrl("http://example.org/pending"));
+    manager->emitChanged(root);
+    QVERIFY(manager->isModified());
+
+    // Another process rewrites the file before the delay elapses
+    QSignalSpy spy(manager, SIGNAL(changed(QString, QString)));
+    QVERIFY(writeBookmarks(fileName, "http://example.org/external"));
+    QVERIFY(spy.wait());
+
+    QVERIFY(!manager->isModified());
+    QVERIFY(manager->flush());
+    QVERIFY(readBookmarks(fileName).contains("http://example.org/pending"));
+
+    delete manager;
+}
+
+QTEST_MAIN(TestBookmarkManager)
+
+#include "bookmarkmanager.moc"
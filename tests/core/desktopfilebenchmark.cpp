@@ -0,0 +1,125 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:BSD$
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of the Hawaii Project nor the
+ *      names of its contributors may be used to endorse or promote products
+ *      derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Pier Luigi Fiorini BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $END_LICENSE$
+ */
+
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTextStream>
+
+#include <VibeCore/VibeCoreExport>
+#include <VibeCore/VDesktopFile>
+#include <VibeCore/VDesktopFileDatabase>
+
+#include "vdesktopentryparser_p.h"
+
+/*
+ * Measures how long it takes to read all the desktop files from the
+ * directories passed on the command line, or the XDG applications
+ * directories when none is given.
+ */
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList directories = app.arguments().mid(1);
+    if (directories.isEmpty())
+        directories = QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation);
+
+    QStringList fileNames;
+    foreach (const QString &directory, directories) {
+        QDirIterator it(directory, QStringList() << "*.desktop", QDir::Files,
+                        QDirIterator::Subdirectories);
+        while (it.hasNext())
+            fileNames.append(it.next());
+    }
+
+    QTextStream out(stdout);
+    out << "Reading " << fileNames.size() << " desktop files from "
+        << directories.join(", ") << endl;
+
+    QElapsedTimer timer;
+    int found = 0;
+
+    // What VDesktopFile used to do
+    timer.start();
+    foreach (const QString &fileName, fileNames) {
+        QSettings settings(fileName, QSettings::IniFormat);
+        settings.beginGroup("Desktop Entry");
+        if (!settings.value("Name").toString().isEmpty())
+            found++;
+    }
+    out << "QSettings: " << timer.elapsed() << " ms, " << found << " names" << endl;
+
+    found = 0;
+    timer.start();
+    foreach (const QString &fileName, fileNames) {
+        VDesktopEntryParser::Values values;
+        VDesktopEntryParser::parseFile(fileName, values);
+        if (!values.value("Name").isEmpty())
+            found++;
+    }
+    out << "VDesktopEntryParser: " << timer.elapsed() << " ms, " << found << " names" << endl;
+
+    found = 0;
+    timer.start();
+    foreach (const QString &fileName, fileNames) {
+        VDesktopFile desktopFile(fileName);
+        if (!desktopFile.name().isEmpty())
+            found++;
+    }
+    out << "VDesktopFile: " << timer.elapsed() << " ms, " << found << " names" << endl;
+
+    timer.start();
+    VDesktopFileDatabase::instance()->load();
+    out << "VDesktopFileDatabase load: " << timer.elapsed() << " ms, "
+        << VDesktopFileDatabase::instance()->fileNames().size() << " entries" << endl;
+
+    found = 0;
+    timer.start();
+    foreach (const QString &fileName, fileNames) {
+        VDesktopFile desktopFile(fileName);
+        if (!desktopFile.name().isEmpty())
+            found++;
+    }
+    out << "VDesktopFile from the database: " << timer.elapsed() << " ms, " << found << " names" << endl;
+
+    return 0;
+}
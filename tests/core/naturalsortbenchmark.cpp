@@ -0,0 +1,125 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:BSD$
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of the Hawaii Project nor the
+ *      names of its contributors may be used to endorse or promote products
+ *      derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Pier Luigi Fiorini BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $END_LICENSE$
+ */
+
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+#include <VibeCore/VStringHandler>
+
+/*
+ * Measures how long it takes to naturally sort a list of file names,
+ * comparing strings every time versus computing sort keys beforehand.
+ * The number of file names can be passed on the command line.
+ */
+
+static bool naturalLessThan(const QString &a, const QString &b)
+{
+    return VStringHandler::naturalCompare(a, b, Qt::CaseInsensitive) < 0;
+}
+
+struct SortItem {
+    QByteArray key;
+    int row;
+};
+
+static bool sortItemLessThan(const SortItem &a, const SortItem &b)
+{
+    return VStringHandler::compareNaturalSortKeys(a.key, b.key) < 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int count = 100000;
+    if (app.arguments().size() > 1)
+        count = app.arguments().at(1).toInt();
+
+    static const char *const words[] = {
+        "Document", "image", "Photo", "report", "backup", "Track", "scan", "notes"
+    };
+    static const char *const extensions[] = {
+        ".txt", ".png", ".jpg", ".pdf", ".tar.gz", ".ogg"
+    };
+
+    qsrand(42);
+    QStringList fileNames;
+    fileNames.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        fileNames.append(QString("%1 %2-%3%4")
+                         .arg(words[qrand() % 8])
+                         .arg(qrand() % 2000)
+                         .arg(qrand() % 100)
+                         .arg(extensions[qrand() % 6]));
+    }
+
+    QTextStream out(stdout);
+    out << "Sorting " << fileNames.size() << " file names" << endl;
+
+    QElapsedTimer timer;
+
+    QStringList compared = fileNames;
+    timer.start();
+    std::sort(compared.begin(), compared.end(), naturalLessThan);
+    out << "naturalCompare(): " << timer.elapsed() << " ms" << endl;
+
+    timer.start();
+    QVector<SortItem> items(fileNames.size());
+    for (int i = 0; i < fileNames.size(); ++i) {
+        items[i].key = VStringHandler::naturalSortKey(fileNames.at(i), Qt::CaseInsensitive);
+        items[i].row = i;
+    }
+    qint64 keysElapsed = timer.elapsed();
+    std::sort(items.begin(), items.end(), sortItemLessThan);
+    out << "naturalSortKey(): " << timer.elapsed() << " ms, of which "
+        << keysElapsed << " ms computing the keys" << endl;
+
+    int mismatches = 0;
+    for (int i = 0; i < items.size(); ++i) {
+        if (VStringHandler::naturalCompare(fileNames.at(items.at(i).row), compared.at(i),
+                                           Qt::CaseInsensitive) != 0)
+            mismatches++;
+    }
+    out << mismatches << " file names sorted differently" << endl;
+
+    return 0;
+}
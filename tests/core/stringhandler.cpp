@@ -0,0 +1,87 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:BSD$
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of the Hawaii Project nor the
+ *      names of its contributors may be used to endorse or promote products
+ *      derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Pier Luigi Fiorini BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $END_LICENSE$
+ */
+
+
+#include <QtTest>
+
+#include <VibeCore/VStringHandler>
+
+/*
+ * Checks that sort keys order strings the same way naturalCompare() does.
+ */
+
+class TestStringHandler : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void naturalSortKey_data();
+    void naturalSortKey();
+};
+
+static int sign(int value)
+{
+    return value < 0 ? -1 : (value > 0 ? 1 : 0);
+}
+
+void TestStringHandler::naturalSortKey_data()
+{
+    QTest::addColumn<QString>("a");
+    QTest::addColumn<QString>("b");
+
+    QTest::newRow("equal") << "file10" << "file10";
+    QTest::newRow("integers") << "file2" << "file10";
+    QTest::newRow("case") << "Track 3" << "track 12";
+    QTest::newRow("leading zero prefix") << "x01" << "x010";
+    QTest::newRow("leading zero prefix, reversed") << "x010" << "x01";
+    QTest::newRow("leading zeros") << "x001" << "x01";
+}
+
+void TestStringHandler::naturalSortKey()
+{
+    QFETCH(QString, a);
+    QFETCH(QString, b);
+
+    const int byCompare = VStringHandler::naturalCompare(a, b, Qt::CaseInsensitive);
+    const int byKey = VStringHandler::compareNaturalSortKeys(
+                          VStringHandler::naturalSortKey(a, Qt::CaseInsensitive),
+                          VStringHandler::naturalSortKey(b, Qt::CaseInsensitive));
+    QCOMPARE(sign(byKey), sign(byCompare));
+}
+
+QTEST_MAIN(TestStringHandler)
+
+#include "stringhandler.moc"
@@ -0,0 +1,369 @@
+/****************************************************************************
+ * This file is part of Vibe.
+ *
+ * Copyright (c) 2012 Pier Luigi Fiorini
+ *
+ * Author(s):
+ *    Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+ *
+ * $BEGIN_LICENSE:BSD$
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of the Hawaii Project nor the
+ *      names of its contributors may be used to endorse or promote products
+ *      derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Pier Luigi Fiorini BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $END_LICENSE$
+ */
+
+#include <QApplication>
+#include <QAbstractListModel>
+#include <QDir>
+#include <QFile>
+#include <QScrollBar>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <VibeWidgets/VCategorizedView>
+#include <VibeWidgets/VCategoryDrawer>
+#include <VibeWidgets/VCategorizedSortFilterProxyModel>
+#include <VibeWidgets/VFileSystemModel>
+
+/*
+ * Measures the hot paths of the item views: layout, painting, scrolling,
+ * row insertion and removal and sorting of a VCategorizedView, and the
+ * throughput of VFileSystemModel::data() on a generated directory.
+ *
+ * Runs without a display, on the offscreen platform, unless another one
+ * is chosen with -platform or QT_QPA_PLATFORM.
+ */
+
+class CategoryModel : public QAbstractListModel
+{
+public:
+    CategoryModel(int rows, int categories, QObject *parent = 0)
+        : QAbstractListModel(parent)
+        , m_categories(categories)
+        , m_nextId(0) {
+        qsrand(42);
+        appendItems(0, rows);
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const {
+        return parent.isValid() ? 0 : m_items.count();
+    }
+
+    QVariant data(const QModelIndex &index, int role) const {
+        if (!index.isValid() || index.row() >= m_items.count())
+            return QVariant();
+
+        const Item &item = m_items.at(index.row());
+        switch (role) {
+            case Qt::DisplayRole:
+                return QString::fromLatin1("Item %1").arg(item.id);
+            case VCategorizedSortFilterProxyModel::CategoryDisplayRole:
+                return QString::fromLatin1("Category %1").arg(item.category);
+            case VCategorizedSortFilterProxyModel::CategorySortRole:
+                return qlonglong(item.category);
+            default:
+                break;
+        }
+
+        return QVariant();
+    }
+
+    void insertItems(int row, int count) {
+        beginInsertRows(QModelIndex(), row, row + count - 1);
+        appendItems(row, count);
+        endInsertRows();
+    }
+
+    void removeItems(int row, int count) {
+        beginRemoveRows(QModelIndex(), row, row + count - 1);
+        m_items.remove(row, count);
+        endRemoveRows();
+    }
+
+private:
+    struct Item {
+        int id;
+        int category;
+    };
+
+    void appendItems(int row, int count) {
+        QVector<Item> items(count);
+        for (int i = 0; i < count; ++i) {
+            items[i].id = m_nextId++;
+            items[i].category = qrand() % m_categories;
+        }
+        m_items.insert(row, count, Item());
+        for (int i = 0; i < count; ++i)
+            m_items[row + i] = items.at(i);
+    }
+
+    int m_categories;
+    int m_nextId;
+    QVector<Item> m_items;
+};
+
+class ViewFixture
+{
+public:
+    ViewFixture(int rows, int categories)
+        : model(rows, categories) {
+        proxyModel.setCategorizedModel(true);
+        proxyModel.setSourceModel(&model);
+        proxyModel.sort(0);
+
+        view.setCategoryDrawer(new VCategoryDrawer(&view));
+        view.setViewMode(QListView::IconMode);
+        view.resize(800, 600);
+        view.setModel(&proxyModel);
+    }
+
+    QModelIndex lastIndex() const {
+        return proxyModel.index(proxyModel.rowCount() - 1, 0);
+    }
+
+    bool show() {
+        view.show();
+        return QTest::qWaitForWindowExposed(&view);
+    }
+
+    CategoryModel model;
+    VCategorizedSortFilterProxyModel proxyModel;
+    VCategorizedView view;
+};
+
+class ItemViewsBenchmark : public QObject
+{
+    Q_OBJECT
+private slots:
+    void layout_data();
+    void layout();
+    void paint_data();
+    void paint();
+    void scroll_data();
+    void scroll();
+    void insertRemove_data();
+    void insertRemove();
+    void sort_data();
+    void sort();
+    void fileSystemModelData_data();
+    void fileSystemModelData();
+
+private:
+    void viewSizes();
+};
+
+void ItemViewsBenchmark::viewSizes()
+{
+    QTest::addColumn<int>("rows");
+    QTest::addColumn<int>("categories");
+
+    static const int rows[] = { 1000, 10000, 100000 };
+    static const int categories[] = { 10, 1000 };
+
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            const QByteArray name = QByteArray::number(rows[i]) + " rows, "
+                                    + QByteArray::number(categories[j]) + " categories";
+            QTest::newRow(name.constData()) << rows[i] << categories[j];
+        }
+    }
+}
+
+void ItemViewsBenchmark::layout_data()
+{
+    viewSizes();
+}
+
+void ItemViewsBenchmark::layout()
+{
+    QFETCH(int, rows);
+    QFETCH(int, categories);
+
+    ViewFixture fixture(rows, categories);
+    const QModelIndex lastIndex = fixture.lastIndex();
+
+    // rebuilds the blocks, then positions every item down to the last one
+    QBENCHMARK {
+        QMetaObject::invokeMethod(&fixture.view, "slotLayoutChanged");
+        fixture.view.visualRect(lastIndex);
+    }
+}
+
+void ItemViewsBenchmark::paint_data()
+{
+    viewSizes();
+}
+
+void ItemViewsBenchmark::paint()
+{
+    QFETCH(int, rows);
+    QFETCH(int, categories);
+
+    ViewFixture fixture(rows, categories);
+    QVERIFY(fixture.show());
+    fixture.view.visualRect(fixture.lastIndex());
+
+    QBENCHMARK {
+        fixture.view.viewport()->repaint();
+    }
+}
+
+void ItemViewsBenchmark::scroll_data()
+{
+    viewSizes();
+}
+
+void ItemViewsBenchmark::scroll()
+{
+    QFETCH(int, rows);
+    QFETCH(int, categories);
+
+    ViewFixture fixture(rows, categories);
+    QVERIFY(fixture.show());
+    fixture.view.visualRect(fixture.lastIndex());
+
+    QScrollBar *scrollBar = fixture.view.verticalScrollBar();
+    const int steps = 50;
+
+    // jumps through the whole view, painting at every stop
+    QBENCHMARK {
+        for (int i = 0; i <= steps; ++i) {
+            scrollBar->setValue(scrollBar->minimum() + (scrollBar->maximum() - scrollBar->minimum()) * qint64(i) / steps);
+            fixture.view.viewport()->repaint();
+        }
+    }
+}
+
+void ItemViewsBenchmark::insertRemove_data()
+{
+    viewSizes();
+}
+
+void ItemViewsBenchmark::insertRemove()
+{
+    QFETCH(int, rows);
+    QFETCH(int, categories);
+
+    ViewFixture fixture(rows, categories);
+    fixture.view.visualRect(fixture.lastIndex());
+
+    const int count = 100;
+    const int row = rows / 2;
+
+    QBENCHMARK {
+        fixture.model.insertItems(row, count);
+        fixture.view.visualRect(fixture.lastIndex());
+        fixture.model.removeItems(row, count);
+        fixture.view.visualRect(fixture.lastIndex());
+    }
+}
+
+void ItemViewsBenchmark::sort_data()
+{
+    viewSizes();
+}
+
+void ItemViewsBenchmark::sort()
+{
+    QFETCH(int, rows);
+    QFETCH(int, categories);
+
+    ViewFixture fixture(rows, categories);
+    fixture.view.visualRect(fixture.lastIndex());
+
+    // the order flips every time, so that each sort actually moves rows
+    Qt::SortOrder order = Qt::AscendingOrder;
+    QBENCHMARK {
+        order = order == Qt::AscendingOrder ? Qt::DescendingOrder : Qt::AscendingOrder;
+        fixture.proxyModel.sort(0, order);
+        fixture.view.visualRect(fixture.lastIndex());
+    }
+}
+
+void ItemViewsBenchmark::fileSystemModelData_data()
+{
+    QTest::addColumn<int>("files");
+
+    QTest::newRow("1000 files") << 1000;
+    QTest::newRow("10000 files") << 10000;
+}
+
+void ItemViewsBenchmark::fileSystemModelData()
+{
+    QFETCH(int, files);
+
+    static const char *const extensions[] = {
+        ".txt", ".png", ".jpg", ".pdf", ".tar.gz", ".ogg", ".desktop", ""
+    };
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QDir root(dir.path());
+    for (int i = 0; i < 10; ++i)
+        QVERIFY(root.mkdir(QString::fromLatin1("Folder %1").arg(i)));
+    for (int i = 0; i < files; ++i) {
+        QFile file(root.filePath(QString::fromLatin1("File %1%2").arg(i).arg(extensions[i % 8])));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+    }
+
+    VFileSystemModel model;
+    QSignalSpy spy(&model, SIGNAL(directoryLoaded(QString)));
+    const QModelIndex rootIndex = model.setRootPath(dir.path());
+    QVERIFY(spy.count() || spy.wait(30000));
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(rootIndex), files + 10, 30000);
+
+    const int rowCount = model.rowCount(rootIndex);
+
+    // the first pass guesses and queues, later ones hit the cache
+    for (int row = 0; row < rowCount; ++row) {
+        const QModelIndex index = model.index(row, 0, rootIndex);
+        model.data(index, Qt::DisplayRole);
+        model.data(index, Qt::DecorationRole);
+    }
+
+    QBENCHMARK {
+        for (int row = 0; row < rowCount; ++row) {
+            const QModelIndex index = model.index(row, 0, rootIndex);
+            model.data(index, Qt::DisplayRole);
+            model.data(index, Qt::DecorationRole);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    ItemViewsBenchmark benchmark;
+    return QTest::qExec(&benchmark, argc, argv);
+}
+
+#include "itemviewsbenchmark.moc"